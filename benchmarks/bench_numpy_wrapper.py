@@ -0,0 +1,90 @@
+""" Benchmarks of ReversibleRandomState methods against numpy generators.
+
+Reports the time per value and output throughput of scalar calls and array
+calls of various shapes for each sampler method of `ReversibleRandomState`
+in both the forward and reverse directions, alongside the equivalent
+`numpy.random.RandomState` and `numpy.random.Generator` methods. Run with
+the extension built in place, for example
+
+    python setup.py build_ext --inplace
+    python benchmarks/bench_numpy_wrapper.py
+"""
+
+__authors__ = 'Matt Graham'
+__license__ = 'MIT'
+
+import argparse
+import timeit
+import numpy as np
+import revrng
+
+SEED = 12345
+SHAPES = [None, (10,), (1000,), (100000,), (1000, 1000)]
+
+
+def time_per_call(func, min_time):
+    """Returns minimum time per call of func over repeated timings."""
+    timer = timeit.Timer(func)
+    n_calls, _ = timer.autorange()
+    n_calls = max(n_calls, int(n_calls * min_time / 0.2))
+    return min(timer.repeat(3, n_calls)) / n_calls
+
+
+def report(name, source, direction, shape, time, itemsize):
+    n_values = 1 if shape is None else int(np.prod(shape))
+    print('{0:<18} {1:<12} {2:<8} {3:>12} {4:10.2f} ns {5:8.3f} GB/s'.format(
+        name, source, direction, 'scalar' if shape is None else str(shape),
+        1e9 * time / n_values, 1e-9 * itemsize * n_values / time))
+
+
+def samplers():
+    """Yields name, ReversibleRandomState call, numpy calls and itemsize."""
+    rs = np.random.RandomState(SEED)
+    gen = np.random.Generator(np.random.MT19937(SEED))
+    yield ('random_int32', lambda s, sh: s.random_int32(sh),
+           lambda sh: rs.randint(2**32, size=sh, dtype=np.uint32),
+           lambda sh: gen.integers(2**32, size=sh, dtype=np.uint32), 4)
+    yield ('random_int64', lambda s, sh: s.random_int64(sh),
+           lambda sh: rs.randint(2**64, size=sh, dtype=np.uint64),
+           lambda sh: gen.integers(2**64, size=sh, dtype=np.uint64), 8)
+    yield ('random_integer', lambda s, sh: s.random_integer(1000, sh),
+           lambda sh: rs.randint(1000, size=sh, dtype=np.uint32),
+           lambda sh: gen.integers(1000, size=sh, dtype=np.uint32), 4)
+    yield ('bernoulli', lambda s, sh: s.bernoulli(0.3, sh),
+           lambda sh: rs.random_sample(sh) < 0.3,
+           lambda sh: gen.random(sh) < 0.3, 1)
+    yield ('standard_uniform', lambda s, sh: s.standard_uniform(sh),
+           lambda sh: rs.random_sample(sh),
+           lambda sh: gen.random(sh), 8)
+    yield ('standard_normal', lambda s, sh: s.standard_normal(sh),
+           lambda sh: rs.standard_normal(sh),
+           lambda sh: gen.standard_normal(sh), 8)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('--min-time', type=float, default=0.2,
+                        help='minimum time in seconds of each timing')
+    parser.add_argument('--samplers', nargs='*',
+                        help='names of samplers to benchmark (default all)')
+    args = parser.parse_args()
+    print('{0:<18} {1:<12} {2:<8} {3:>12} {4:>13} {5:>13}'.format(
+        'sampler', 'source', 'dir', 'shape', 'time / value', 'throughput'))
+    for name, method, rs_call, gen_call, itemsize in samplers():
+        if args.samplers and name not in args.samplers:
+            continue
+        for shape in SHAPES:
+            state = revrng.ReversibleRandomState(SEED)
+            for direction in ('forward', 'reverse'):
+                time = time_per_call(
+                    lambda: method(state, shape), args.min_time)
+                report(name, 'revrng', direction, shape, time, itemsize)
+                state.reverse()
+            for source, call in (('RandomState', rs_call),
+                                 ('Generator', gen_call)):
+                time = time_per_call(lambda: call(shape), args.min_time)
+                report(name, source, 'forward', shape, time, itemsize)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,151 @@
+/*
+ * Microbenchmarks of reversible Mersenne-Twister generator functions.
+ *
+ * Author: Matt Graham (matt-graham.github.io)
+ *
+ * Reports the time per call of the key update functions and the time per
+ * value and output throughput of the scalar and array generator functions,
+ * in both the forward and reverse directions. Built as the bench_revrand
+ * target of the CMake build, or from the repository root with the same flags
+ * as the Python extension, for example
+ *
+ *   cc -O3 -ffp-contract=off -fno-math-errno -fno-trapping-math \
+ *       -Irevrng benchmarks/bench_revrand.c revrng/revrand.c -lm \
+ *       -o bench_revrand
+ *
+ * and run as `bench_revrand [n_values]`.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "revrand.h"
+
+#define SEED 12345UL
+#define N_TWISTS 20000
+#define DEFAULT_N_VALUES 10000000UL
+#define ARRAY_SIZE 100000UL
+
+/* Returns wall clock time in seconds. */
+static double now(void)
+{
+    struct timespec t;
+    timespec_get(&t, TIME_UTC);
+    return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+/* Prints time per call (and throughput if bytes per call is non-zero). */
+static void report(const char *name, const char *direction, double time,
+                   double n_calls, double bytes_per_call)
+{
+    printf("%-26s %-8s %9.2f ns", name, direction, 1e9 * time / n_calls);
+    if (bytes_per_call > 0) {
+        printf(" %8.2f GB/s", 1e-9 * bytes_per_call * n_calls / time);
+    }
+    printf("\n");
+}
+
+/* Accumulated outputs, printed to prevent the calls being optimised out. */
+static double sink = 0;
+
+static void bench_twists(void)
+{
+    rng_state state;
+    double start, time;
+    int i;
+    revrand_init_state(SEED, &state);
+    start = now();
+    for (i = 0; i < N_TWISTS; i++) {
+        revrand_twist(&state);
+    }
+    time = now() - start;
+    report("twist", "forward", time, N_TWISTS, 0);
+    start = now();
+    for (i = 0; i < N_TWISTS; i++) {
+        revrand_reverse_twist(&state);
+    }
+    time = now() - start;
+    report("reverse_twist", "reverse", time, N_TWISTS, 0);
+    sink += state.key[0];
+}
+
+/* Benchmarks n scalar calls in forward then reverse direction. */
+#define BENCH_SCALAR(name, call, value_size) \
+    do { \
+        rng_state state; \
+        double start, time; \
+        size_t i; \
+        int r; \
+        revrand_init_state(SEED, &state); \
+        for (r = 0; r < 2; r++) { \
+            start = now(); \
+            for (i = 0; i < n; i++) { \
+                sink += (double) (call); \
+            } \
+            time = now() - start; \
+            report(name, r == 0 ? "forward" : "reverse", time, n, \
+                   value_size); \
+            revrand_reverse(&state); \
+        } \
+    } while (0)
+
+/* Benchmarks n values generated in ARRAY_SIZE arrays in each direction. */
+#define BENCH_ARRAY(name, func, type) \
+    do { \
+        rng_state state; \
+        type *values = malloc(ARRAY_SIZE * sizeof(type)); \
+        double start, time; \
+        size_t i; \
+        int r; \
+        if (values == NULL) { \
+            return 1; \
+        } \
+        revrand_init_state(SEED, &state); \
+        for (r = 0; r < 2; r++) { \
+            start = now(); \
+            for (i = 0; i < n; i += ARRAY_SIZE) { \
+                func(&state, values, ARRAY_SIZE); \
+            } \
+            time = now() - start; \
+            report(name, r == 0 ? "forward" : "reverse", time, \
+                   (double) ARRAY_SIZE * ((n + ARRAY_SIZE - 1) / ARRAY_SIZE), \
+                   sizeof(type)); \
+            sink += (double) values[ARRAY_SIZE - 1]; \
+            revrand_reverse(&state); \
+        } \
+        free(values); \
+    } while (0)
+
+static double normal_pair(rng_state *state)
+{
+    double ret_1, ret_2;
+    revrand_random_normal_pair(state, &ret_1, &ret_2);
+    return ret_1 + ret_2;
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_N_VALUES;
+    if (n == 0) {
+        fprintf(stderr, "Number of values must be positive.\n");
+        return 1;
+    }
+    printf("%-26s %-8s %12s %13s\n", "function", "dir", "time / call",
+           "throughput");
+    bench_twists();
+    BENCH_SCALAR("random_int32", revrand_random_int32(&state), 4);
+    BENCH_SCALAR("random_uniform", revrand_random_uniform(&state), 8);
+    /* each call generates two values */
+    BENCH_SCALAR("random_normal_pair", normal_pair(&state), 16);
+    BENCH_SCALAR("random_normal_icdf", revrand_random_normal_icdf(&state), 8);
+    BENCH_ARRAY("random_uint32_array", revrand_random_uint32_array, uint32_t);
+    BENCH_ARRAY("random_int64_array", revrand_random_int64_array, uint64_t);
+    BENCH_ARRAY("random_uniform_array", revrand_random_uniform_array, double);
+    BENCH_ARRAY("random_uniform_float_array",
+                revrand_random_uniform_float_array, float);
+    BENCH_ARRAY("random_normal_array", revrand_random_normal_array, double);
+    BENCH_ARRAY("random_normal_icdf_array", revrand_random_normal_icdf_array,
+                double);
+    fprintf(stderr, "(checksum %g)\n", sink);
+    return 0;
+}
@@ -1 +1,19 @@
-from .numpy_wrapper import ReversibleRandomState
+import os
+
+from .numpy_wrapper import (
+    ReversibleRandomState, ReversibleRandomStateBatch, independent_streams,
+    states_from_seeds)
+from .tapes import Tape, read_tape, write_tape
+try:
+    from .bit_generator import ReversibleMT19937
+except ImportError:
+    # bit generator only built when numpy supports BitGenerator subclasses
+    pass
+
+
+def get_include():
+    """
+    Directory containing revrand.h and numpy_wrapper.pxd, to add to include
+    paths when compiling extension modules which cimport revrng.
+    """
+    return os.path.dirname(os.path.abspath(__file__))
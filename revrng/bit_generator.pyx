@@ -0,0 +1,153 @@
+#cython: embedsignature=True
+""" Reversible Mersenne-Twister bit generator for numpy.random.Generator. """
+
+__authors__ = 'Matt Graham'
+__license__ = 'MIT'
+
+import numpy as np
+cimport numpy as np
+from libc.stdint cimport uint32_t, uint64_t
+from libc.string cimport memcpy
+from numpy.random cimport bitgen_t
+from numpy.random.bit_generator cimport BitGenerator
+from revrng.numpy_wrapper cimport (
+    KEY_LENGTH, rng_state, init_state, reset_counters, reverse, jump,
+    random_int32, random_int64, random_uniform)
+
+
+cdef uint64_t bitgen_uint64(void *state) nogil:
+    return random_int64(<rng_state*>state)
+
+
+cdef uint32_t bitgen_uint32(void *state) nogil:
+    return <uint32_t>random_int32(<rng_state*>state)
+
+
+cdef double bitgen_double(void *state) nogil:
+    return random_uniform(<rng_state*>state)
+
+
+cdef uint64_t bitgen_raw(void *state) nogil:
+    return random_int32(<rng_state*>state)
+
+
+cdef class ReversibleMT19937(BitGenerator):
+    """
+    Reversible Mersenne-Twister bit generator.
+
+    Exposes the reversible generator of ReversibleRandomState as a numpy
+    BitGenerator to use with `numpy.random.Generator`, with 32-bit, 64-bit
+    and double draws equal to those of the `random_int32`, `random_int64`
+    and `standard_uniform` methods of a ReversibleRandomState with the same
+    seed.
+
+    After calling `reverse`, a draw which uses a fixed number of random
+    integers regenerates the most recent values drawn in the forward
+    direction, in reverse order. For example for a Generator `gen`
+
+        values = gen.random(10)
+        gen.bit_generator.reverse()
+        assert np.all(gen.random(10) == values[::-1])
+
+    Distributions which use rejection sampling (such as `integers` and
+    `standard_normal`) use a variable number of random integers so are
+    not in general reversed exactly.
+    """
+
+    cdef rng_state rng
+
+    def __init__(self, seed):
+        """
+        Reversible Mersenne-Twister bit generator.
+
+        Parameters
+        ----------
+        seed : int
+            Integer seed in range [0, 2**32 - 1].
+
+        Raises
+        ------
+            ValueError: Seed outside of [0, 2**32 - 1] specified.
+            TypeError: Non-integer seed.
+        """
+        try:
+            seed = int(seed)
+        except TypeError:
+            raise TypeError("Seed must be an integer.")
+        if seed > int(2**32 - 1) or seed < 0:
+            raise ValueError("Seed must be in integer in [0, 2**32 - 1].")
+        BitGenerator.__init__(self, seed)
+        init_state(seed, &self.rng)
+        self._bitgen.state = <void*>&self.rng
+        self._bitgen.next_uint64 = &bitgen_uint64
+        self._bitgen.next_uint32 = &bitgen_uint32
+        self._bitgen.next_double = &bitgen_double
+        self._bitgen.next_raw = &bitgen_raw
+
+    def reverse(self):
+        """
+        Reverse direction of random number generator updates.
+        """
+        with self.lock:
+            reverse(&self.rng)
+
+    def jump(self, n):
+        """
+        Jump state of bit generator by a number of 32-bit random integers.
+
+        For `n >= 0` equivalent to discarding `n` 32-bit values in the
+        current direction and for `n < 0` to rewinding the last `-n`
+        values. Each 64-bit and double value uses two 32-bit values.
+
+        Parameters
+        ----------
+        n : int
+            Number of 32-bit random integers to jump by.
+        """
+        cdef long long n_ = n
+        with self.lock, nogil:
+            jump(&self.rng, n_)
+
+    @property
+    def state(self):
+        """
+        Dictionary representing the internal state of the generator, with
+        `state` entry in the format of `ReversibleRandomState.get_state`.
+        """
+        cdef np.ndarray key = np.empty(KEY_LENGTH, np.uint32)
+        with self.lock:
+            memcpy(key.data, self.rng.key, KEY_LENGTH * sizeof(uint32_t))
+            state = {
+                'seed': self.rng.seed,
+                'key': key,
+                'pos': self.rng.pos,
+                'reversed': self.rng.reversed,
+                'n_twists': self.rng.n_twists
+            }
+        return {'bit_generator': type(self).__name__, 'state': state}
+
+    @state.setter
+    def state(self, value):
+        cdef np.ndarray key
+        if (not isinstance(value, dict) or
+                value.get('bit_generator') != type(self).__name__):
+            raise ValueError(
+                "State must be a dict for {0}.".format(type(self).__name__))
+        state = value['state']
+        key = np.ascontiguousarray(state['key'], np.uint32)
+        if key.size != KEY_LENGTH:
+            raise ValueError("Key must have {0} entries.".format(KEY_LENGTH))
+        pos = int(state['pos'])
+        reversed = 1 if state['reversed'] else 0
+        # forward draws move to the next block at pos == KEY_LENGTH and
+        # reverse draws to the previous block at pos == -1, as in set_state
+        # of ReversibleRandomState
+        if pos < -reversed or pos > KEY_LENGTH - reversed:
+            raise ValueError("Key position out of range for direction.")
+        with self.lock:
+            self.rng.seed = state['seed']
+            memcpy(self.rng.key, key.data, KEY_LENGTH * sizeof(uint32_t))
+            self.rng.pos = pos
+            self.rng.reversed = reversed
+            self.rng.n_twists = state['n_twists']
+            reset_counters(&self.rng)
@@ -0,0 +1,192 @@
+# Declarations of the reversible random number generator C functions and of
+# the ReversibleRandomState extension type, for use from other Cython modules.
+#
+# As the C functions are compiled in to the numpy_wrapper extension module,
+# other extension modules should not call them directly but through the
+# function table in the `interface` attribute of a ReversibleRandomState (or
+# equivalently the `revrng.rng_interface` capsule returned by its `capsule`
+# property), for example from inside a nogil loop
+#
+#     from revrng.numpy_wrapper cimport ReversibleRandomState, rng_interface
+#
+#     cdef ReversibleRandomState state = ReversibleRandomState(seed)
+#     cdef rng_interface *rng = &state.interface
+#     with state.lock, nogil:
+#         for i in range(n):
+#             values[i] = rng.random_uniform(rng.state)
+#
+# Compiling such modules requires the directory returned by
+# `revrng.get_include()` on the include path.
+
+from libc.stdint cimport uint32_t, uint64_t
+
+
+cdef extern from "revrand.h":
+
+    # C names are prefixed with revrand_ to avoid clashes when linked in to
+    # other programs, with the unprefixed names used here for brevity
+
+    cdef enum:
+        KEY_LENGTH "REVRAND_KEY_LENGTH"
+        ENGINE_MT19937 "REVRAND_ENGINE_MT19937"
+        ENGINE_PHILOX "REVRAND_ENGINE_PHILOX"
+
+    ctypedef struct rng_checkpoints:
+        uint32_t *keys
+        long long *tags
+        size_t capacity
+
+    ctypedef struct rng_lookahead:
+        uint32_t key[KEY_LENGTH]
+        long long tag
+
+    ctypedef struct rng_counters:
+        long long twists
+        long long reverse_twists
+        long long checkpoint_loads
+        long long lookahead_loads
+        long long jumps
+        long long forward_words
+        long long reverse_words
+        long long reversals
+        long long word_mark
+
+    ctypedef struct rng_state:
+        unsigned long seed
+        uint32_t key[KEY_LENGTH]
+        int pos
+        int reversed
+        long long n_twists
+        int engine
+        int carry_normals
+        int has_spare_normal
+        double spare_normals[2]
+        rng_checkpoints *checkpoints
+        rng_lookahead *lookahead
+        rng_counters counters
+
+    ctypedef struct rng_batch:
+        size_t n_streams
+        uint32_t *keys
+        unsigned long *seeds
+        int pos
+        int reversed
+        long long n_twists
+
+    ctypedef struct rng_interface:
+        rng_state *state
+        unsigned long (*random_int32)(rng_state *state) nogil
+        uint64_t (*random_int64)(rng_state *state) nogil
+        uint32_t (*random_bounded)(rng_state *state, uint64_t bound) nogil
+        double (*random_uniform)(rng_state *state) nogil
+        float (*random_uniform_float)(rng_state *state) nogil
+        void (*random_normal_pair)(
+            rng_state *state, double *ret_1, double *ret_2) nogil
+        double (*random_normal_icdf)(rng_state *state) nogil
+        void (*reverse)(rng_state *state) nogil
+        void (*jump)(rng_state *state, long long n) nogil
+
+    void init_state "revrand_init_state"(unsigned long seed, rng_state *state)
+    void init_philox_state "revrand_init_philox_state"(
+        unsigned long seed, rng_state *state)
+    void init_states "revrand_init_states"(
+        const unsigned long *seeds, rng_state *states, size_t n) nogil
+    void clear_checkpoints "revrand_clear_checkpoints"(
+        rng_checkpoints *checkpoints) nogil
+    void clear_lookahead "revrand_clear_lookahead"(
+        rng_lookahead *lookahead) nogil
+    void prepare_block "revrand_prepare_block"(
+        const rng_state *state, rng_lookahead *lookahead) nogil
+    int counters_enabled "revrand_counters_enabled"()
+    void reset_counters "revrand_reset_counters"(rng_state *state) nogil
+    void get_counters "revrand_get_counters"(
+        const rng_state *state, rng_counters *counters) nogil
+    void merge_counters "revrand_merge_counters"(
+        rng_state *state, const rng_state *base, const rng_state *copies,
+        size_t n) nogil
+    void reverse "revrand_reverse"(rng_state *state) nogil
+    void jump "revrand_jump"(rng_state *state, long long n) nogil
+    void fill_range "revrand_fill_range"(
+        rng_state *state, long long k0, long long k1, uint32_t *values) nogil
+    uint32_t value_at "revrand_value_at"(rng_state *state, long long k) nogil
+    void init_streams "revrand_init_streams"(
+        unsigned long seed, rng_state *states, size_t n_streams,
+        long long stream_twists) nogil
+    unsigned long random_int32 "revrand_random_int32"(rng_state *state) nogil
+    void random_int32_array "revrand_random_int32_array"(
+        rng_state *state, unsigned long *values, size_t n) nogil
+    void random_uint32_array "revrand_random_uint32_array"(
+        rng_state *state, uint32_t *values, size_t n) nogil
+    uint64_t random_int64 "revrand_random_int64"(rng_state *state) nogil
+    uint32_t random_bounded "revrand_random_bounded"(
+        rng_state *state, uint64_t bound) nogil
+    void random_int64_array "revrand_random_int64_array"(
+        rng_state *state, uint64_t *values, size_t n) nogil
+    void random_bounded_array "revrand_random_bounded_array"(
+        rng_state *state, uint64_t bound, uint32_t *values, size_t n) nogil
+    void random_bernoulli_masks "revrand_random_bernoulli_masks"(
+        rng_state *state, uint64_t p, uint32_t *masks, size_t n) nogil
+    int bernoulli_words "revrand_bernoulli_words"(uint64_t p) nogil
+    double random_uniform "revrand_random_uniform"(rng_state *state) nogil
+    void random_uniform_array "revrand_random_uniform_array"(
+        rng_state *state, double *values, size_t n) nogil
+    float random_uniform_float "revrand_random_uniform_float"(
+        rng_state *state) nogil
+    void random_uniform_float_array "revrand_random_uniform_float_array"(
+        rng_state *state, float *values, size_t n) nogil
+    void random_normal_pair "revrand_random_normal_pair"(
+        rng_state *state, double *ret_1, double *ret_2) nogil
+    double random_normal "revrand_random_normal"(rng_state *state) nogil
+    void random_normal_array "revrand_random_normal_array"(
+        rng_state *state, double *values, size_t n) nogil
+    void random_multivariate_normal "revrand_random_multivariate_normal"(
+        rng_state *state, size_t dim, const double *mean, const double *chol,
+        double *values, size_t n) nogil
+    void random_normal_float_pair "revrand_random_normal_float_pair"(
+        rng_state *state, float *ret_1, float *ret_2) nogil
+    void random_normal_float_array "revrand_random_normal_float_array"(
+        rng_state *state, float *values, size_t n) nogil
+    double random_normal_icdf "revrand_random_normal_icdf"(
+        rng_state *state) nogil
+    void random_normal_icdf_array "revrand_random_normal_icdf_array"(
+        rng_state *state, double *values, size_t n) nogil
+
+    void init_batch "revrand_init_batch"(
+        const unsigned long *seeds, rng_batch *batch) nogil
+    void reverse_batch "revrand_reverse_batch"(rng_batch *batch) nogil
+    void get_batch_state "revrand_get_batch_state"(
+        const rng_batch *batch, size_t s, rng_state *state) nogil
+    void random_int32_batch "revrand_random_int32_batch"(
+        rng_batch *batch, uint32_t *values) nogil
+    void random_uniform_batch "revrand_random_uniform_batch"(
+        rng_batch *batch, double *values) nogil
+    void random_normal_icdf_batch "revrand_random_normal_icdf_batch"(
+        rng_batch *batch, double *values) nogil
+
+cdef class ReversibleRandomState:
+
+    cdef rng_state *internal_state
+    cdef rng_state *cursor
+    cdef rng_interface interface
+    cdef rng_checkpoints checkpoints
+    cdef rng_checkpoints cursor_checkpoints
+    cdef rng_lookahead *lookahead
+    cdef int engine
+    cdef bint carry_normals
+    cdef readonly object lock
+    cdef bint thread_safe
+    cdef size_t n_threads
+    cdef size_t parallel_threshold
+
+    cdef object configure(self, n_threads, parallel_threshold, thread_safe,
+                          checkpoint_memory, lookahead, engine,
+                          carry_normals)
+    cdef void seed_state(self, unsigned long seed, rng_state *state)
+    cdef void attach_caches(self)
+    cdef rng_state *stream_cursor(self) except NULL
+
+
+cdef class ReversibleRandomStateBatch:
+
+    cdef rng_batch batch
+    cdef readonly object lock
@@ -6,78 +6,359 @@ __license__ = 'MIT'
 
 import numpy as np
 cimport numpy as np
+np.import_array()
 from cpython.mem cimport PyMem_Malloc, PyMem_Free
+from cpython.pycapsule cimport PyCapsule_New
+from libc.stdint cimport uint32_t, uint64_t
+from libc.string cimport memcpy
 try:
-    from threading import Lock
+    from threading import Lock, Thread
 except ImportError:
-    from dummy_threading import Lock
+    from dummy_threading import Lock, Thread
 
 
-cdef extern from "revrand.h":
+ctypedef unsigned long (* ulong_rand_func)(rng_state *state) nogil
+ctypedef void (* ulong_array_rand_func)(
+    rng_state *state, unsigned long *values, size_t n) nogil
+ctypedef void (* uint32_array_rand_func)(
+    rng_state *state, uint32_t *values, size_t n) nogil
+ctypedef uint64_t (* uint64_rand_func)(rng_state *state) nogil
+ctypedef void (* uint64_array_rand_func)(
+    rng_state *state, uint64_t *values, size_t n) nogil
+ctypedef void (* uint32_param_array_rand_func)(
+    rng_state *state, uint64_t param, uint32_t *values, size_t n) nogil
+ctypedef double (* double_rand_func)(rng_state *state) nogil
+ctypedef void (* double_array_rand_func)(
+    rng_state *state, double *values, size_t n) nogil
+ctypedef float (* float_rand_func)(rng_state *state) nogil
+ctypedef void (* float_array_rand_func)(
+    rng_state *state, float *values, size_t n) nogil
+ctypedef void (* float_pair_rand_func)(
+    rng_state *state, float *ret_1, float *ret_2) nogil
 
-    cdef enum: KEY_LENGTH
 
-    ctypedef struct rng_state:
-        unsigned long seed
-        unsigned long key[KEY_LENGTH]
-        int pos
-        int reversed
-        int n_twists
+cdef class ChunkedArrayFill:
+    """
+    Fill of an array in contiguous chunks for generation in parallel threads.
 
-    void init_state(unsigned long seed, rng_state *state)
-    void reverse(rng_state *state)
-    unsigned long random_int32(rng_state *state) nogil
-    double random_uniform(rng_state *state) nogil
-    void random_normal_pair(
-        rng_state *state, double *ret_1, double *ret_2) nogil
+    Each chunk is generated from a copy of the generator state jumped by the
+    number of random integers a serial fill of the whole array would use
+    before reaching the chunk, so the array values are exactly those of a
+    serial fill in either direction.
+    """
 
+    cdef rng_state *states
+    cdef size_t *starts
+    cdef long long *skips
+    cdef size_t n_chunks
+    cdef char *values
+    cdef size_t item_size
+    # array function for dtype of values, with all others NULL
+    cdef ulong_array_rand_func ulong_array_func
+    cdef uint32_array_rand_func uint32_array_func
+    cdef uint64_array_rand_func uint64_array_func
+    cdef uint32_param_array_rand_func uint32_param_array_func
+    cdef uint64_t param
+    cdef double_array_rand_func double_array_func
+    cdef float_array_rand_func float_array_func
 
-ctypedef unsigned long (* ulong_rand_func)(rng_state *state) nogil
-ctypedef double (* double_rand_func)(rng_state *state) nogil
-ctypedef void (* double_pair_rand_func)(
-    rng_state *state, double *ret_1, double *ret_2) nogil
+    def __cinit__(self):
+        self.states = NULL
+        self.starts = NULL
+        self.skips = NULL
+        self.ulong_array_func = NULL
+        self.uint32_array_func = NULL
+        self.uint64_array_func = NULL
+        self.uint32_param_array_func = NULL
+        self.double_array_func = NULL
+        self.float_array_func = NULL
+
+    def __dealloc__(self):
+        PyMem_Free(self.states)
+        PyMem_Free(self.starts)
+        PyMem_Free(self.skips)
+
+    def fill_chunk(self, size_t j):
+        cdef rng_state *state = &self.states[j]
+        cdef char *values = self.values + self.starts[j] * self.item_size
+        cdef size_t n = self.starts[j + 1] - self.starts[j]
+        cdef long long skip = self.skips[j]
+        with nogil:
+            jump(state, skip)
+            if self.ulong_array_func != NULL:
+                self.ulong_array_func(state, <unsigned long*>values, n)
+            elif self.uint32_array_func != NULL:
+                self.uint32_array_func(state, <uint32_t*>values, n)
+            elif self.uint64_array_func != NULL:
+                self.uint64_array_func(state, <uint64_t*>values, n)
+            elif self.uint32_param_array_func != NULL:
+                self.uint32_param_array_func(
+                    state, self.param, <uint32_t*>values, n)
+            elif self.double_array_func != NULL:
+                self.double_array_func(state, <double*>values, n)
+            else:
+                self.float_array_func(state, <float*>values, n)
+
+
+cdef object fill_array_parallel(
+        rng_state *state, np.ndarray values, ChunkedArrayFill fill,
+        int words_per_value, bint pairs, size_t n_threads):
+    """
+    Fills values in n_threads chunks in parallel, leaving state as a serial
+    fill would, using the array function set in fill for the values dtype.
+    words_per_value random integers are used per value, and if
+    pairs is true values are generated in pairs with the odd final value of
+    an odd sized array generated from a discarded pair.
+    """
+    cdef size_t j, chunk_size, n = <size_t>values.size
+    cdef long long n_after
+    cdef rng_checkpoints *checkpoints
+    cdef rng_lookahead *lookahead
+    cdef rng_state base = state[0]
+    fill.states = <rng_state*> PyMem_Malloc(n_threads * sizeof(rng_state))
+    fill.starts = <size_t*> PyMem_Malloc((n_threads + 1) * sizeof(size_t))
+    fill.skips = <long long*> PyMem_Malloc(n_threads * sizeof(long long))
+    if fill.states == NULL or fill.starts == NULL or fill.skips == NULL:
+        raise MemoryError()
+    fill.n_chunks = n_threads
+    fill.values = values.data
+    fill.item_size = <size_t>values.itemsize
+    # chunks start at even indices if paired so pairs do not straddle chunks
+    chunk_size = n // n_threads
+    if pairs:
+        chunk_size -= chunk_size % 2
+    for j in range(n_threads):
+        fill.starts[j] = j * chunk_size
+    fill.starts[n_threads] = n
+    # forward fills generate chunks in increasing index order, reverse fills
+    # in decreasing index order including any odd final value first
+    for j in range(n_threads):
+        fill.states[j] = state[0]
+        # chunk states must not share the (unsynchronised) checkpoint cache
+        # or lookahead buffer
+        fill.states[j].checkpoints = NULL
+        fill.states[j].lookahead = NULL
+        if state.reversed == 0:
+            fill.skips[j] = words_per_value * <long long>fill.starts[j]
+        else:
+            n_after = n - fill.starts[j + 1]
+            fill.skips[j] = words_per_value * n_after
+            if pairs and n_after % 2 == 1:
+                fill.skips[j] += words_per_value
+    threads = [
+        Thread(target=fill.fill_chunk, args=(j,)) for j in range(1, n_threads)
+    ]
+    for thread in threads:
+        thread.start()
+    fill.fill_chunk(0)
+    for thread in threads:
+        thread.join()
+    # final state is that after chunk generated last
+    checkpoints = state.checkpoints
+    lookahead = state.lookahead
+    if state.reversed == 0:
+        state[0] = fill.states[n_threads - 1]
+    else:
+        state[0] = fill.states[0]
+    state.checkpoints = checkpoints
+    state.lookahead = lookahead
+    # chunk states cleared only their own (absent) caches when moving before
+    # the initial key, whose keys depend on the path taken to them
+    if base.n_twists >= 0 and state.n_twists < 0:
+        if checkpoints != NULL:
+            clear_checkpoints(checkpoints)
+        if lookahead != NULL:
+            clear_lookahead(lookahead)
+    # counts include work of all chunks, not only that generated last
+    merge_counters(state, &base, fill.states, n_threads)
+
+
+cdef bint use_parallel_fill(
+        size_t values_size, size_t n_threads, size_t parallel_threshold):
+    return (n_threads > 1 and values_size >= parallel_threshold and
+            values_size >= 2 * n_threads)
+
+
+cdef tuple prepare_values(object shape, object out, object dtype):
+    """
+    Returns a tuple `(values, target, result)` of a C-contiguous array of
+    dtype to generate values in to, an array to copy the values in to after
+    generation (or None) and the object to return. If out is specified and
+    is a C-contiguous array of dtype, values are generated directly in it,
+    otherwise values are generated in a new array and copied in to out
+    (which may be any writeable buffer with values castable from dtype).
+    """
+    cdef np.ndarray out_array
+    if out is None:
+        values = np.empty(shape=shape, dtype=dtype)
+        return values, None, values
+    out_array = np.asarray(out)
+    if not out_array.flags.writeable:
+        raise ValueError("Output array must be writeable.")
+    if not np.can_cast(dtype, out_array.dtype, 'same_kind'):
+        raise TypeError("Cannot generate values of dtype {0} in to output "
+                        "array of dtype {1}.".format(
+                            np.dtype(dtype), out_array.dtype))
+    if shape is not None:
+        try:
+            shape = tuple(shape)
+        except TypeError:
+            shape = (shape,)
+        if shape != out_array.shape:
+            raise ValueError("Shape {0} does not match output array shape "
+                             "{1}.".format(shape, out_array.shape))
+    if out_array.dtype == dtype and out_array.flags.c_contiguous:
+        return out_array, None, out
+    return np.empty(out_array.shape, dtype), out_array, out
 
 
 cdef object assign_random_ulong_array(
-        rng_state *state, ulong_rand_func func, object shape, object lock):
+        rng_state *state, ulong_rand_func func,
+        ulong_array_rand_func array_func, object shape, object out,
+        object lock, size_t n_threads, size_t parallel_threshold):
     cdef np.ndarray values
+    cdef ChunkedArrayFill fill
     cdef unsigned long* values_data
-    cdef size_t values_size, i
-    if shape is not None:
-        values = <np.ndarray>np.empty(shape=shape, dtype=np.uint64)
+    cdef size_t values_size
+    if shape is not None or out is not None:
+        values, target, result = prepare_values(shape, out, np.uint64)
         values_data = <unsigned long*>values.data
         values_size = <size_t>values.size
+        if use_parallel_fill(values_size, n_threads, parallel_threshold):
+            fill = ChunkedArrayFill()
+            fill.ulong_array_func = array_func
+            with lock:
+                fill_array_parallel(
+                    state, values, fill, 1, False, n_threads)
+        else:
+            with lock, nogil:
+                array_func(state, values_data, values_size)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
+    else:
         with lock, nogil:
-            if state.reversed == 0:
-                for i in range(0, values_size):
-                    values_data[i] = func(state)
-            else:
-                for i in range(values_size - 1, -1, -1):
-                    values_data[i] = func(state)
-        return values
+            value = func(state)
+        return value
+
+
+cdef object assign_random_uint32_array(
+        rng_state *state, ulong_rand_func func,
+        uint32_array_rand_func array_func, object shape, object out,
+        object lock, size_t n_threads, size_t parallel_threshold):
+    cdef np.ndarray values
+    cdef ChunkedArrayFill fill
+    cdef uint32_t* values_data
+    cdef size_t values_size
+    if shape is not None or out is not None:
+        values, target, result = prepare_values(shape, out, np.uint32)
+        values_data = <uint32_t*>values.data
+        values_size = <size_t>values.size
+        if use_parallel_fill(values_size, n_threads, parallel_threshold):
+            fill = ChunkedArrayFill()
+            fill.uint32_array_func = array_func
+            with lock:
+                fill_array_parallel(
+                    state, values, fill, 1, False, n_threads)
+        else:
+            with lock, nogil:
+                array_func(state, values_data, values_size)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
     else:
         with lock, nogil:
             value = func(state)
         return value
 
 
+cdef object assign_random_uint64_array(
+        rng_state *state, uint64_rand_func func,
+        uint64_array_rand_func array_func, object shape, object out,
+        object lock, size_t n_threads, size_t parallel_threshold):
+    cdef np.ndarray values
+    cdef ChunkedArrayFill fill
+    cdef uint64_t* values_data
+    cdef size_t values_size
+    if shape is not None or out is not None:
+        values, target, result = prepare_values(shape, out, np.uint64)
+        values_data = <uint64_t*>values.data
+        values_size = <size_t>values.size
+        if use_parallel_fill(values_size, n_threads, parallel_threshold):
+            fill = ChunkedArrayFill()
+            fill.uint64_array_func = array_func
+            with lock:
+                fill_array_parallel(
+                    state, values, fill, 2, False, n_threads)
+        else:
+            with lock, nogil:
+                array_func(state, values_data, values_size)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
+    else:
+        with lock, nogil:
+            value = func(state)
+        return value
+
+
+cdef object assign_random_uint32_param_array(
+        rng_state *state, uint64_t param,
+        uint32_param_array_rand_func array_func, int words_per_value,
+        object shape, object out, object lock, size_t n_threads,
+        size_t parallel_threshold):
+    cdef np.ndarray values
+    cdef ChunkedArrayFill fill
+    cdef uint32_t* values_data
+    cdef uint32_t value
+    cdef size_t values_size
+    if shape is not None or out is not None:
+        values, target, result = prepare_values(shape, out, np.uint32)
+        values_data = <uint32_t*>values.data
+        values_size = <size_t>values.size
+        if use_parallel_fill(values_size, n_threads, parallel_threshold):
+            fill = ChunkedArrayFill()
+            fill.uint32_param_array_func = array_func
+            fill.param = param
+            with lock:
+                fill_array_parallel(
+                    state, values, fill, words_per_value, False, n_threads)
+        else:
+            with lock, nogil:
+                array_func(state, param, values_data, values_size)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
+    else:
+        with lock, nogil:
+            array_func(state, param, &value, 1)
+        return value
+
+
 cdef object assign_random_double_array(
-        rng_state *state, double_rand_func func, object shape, object lock):
+        rng_state *state, double_rand_func func,
+        double_array_rand_func array_func, object shape, object out,
+        object lock, size_t n_threads, size_t parallel_threshold):
     cdef np.ndarray values
+    cdef ChunkedArrayFill fill
     cdef double* values_data
-    cdef size_t values_size, i
-    if shape is not None:
-        values = <np.ndarray>np.empty(shape=shape, dtype=np.float64)
+    cdef size_t values_size
+    if shape is not None or out is not None:
+        values, target, result = prepare_values(shape, out, np.float64)
         values_data = <double*>values.data
         values_size = <size_t>values.size
-        with lock, nogil:
-            if state.reversed == 0:
-                for i in range(0, values_size):
-                    values_data[i] = func(state)
-            else:
-                for i in range(values_size - 1, -1, -1):
-                    values_data[i] = func(state)
-        return values
+        if use_parallel_fill(values_size, n_threads, parallel_threshold):
+            fill = ChunkedArrayFill()
+            fill.double_array_func = array_func
+            with lock:
+                fill_array_parallel(
+                    state, values, fill, 2, False, n_threads)
+        else:
+            with lock, nogil:
+                array_func(state, values_data, values_size)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
     else:
         with lock, nogil:
             value = func(state)
@@ -85,47 +366,151 @@ cdef object assign_random_double_array(
 
 
 cdef object assign_random_double_pair_array(
-        rng_state *state, double_pair_rand_func func, object shape,
-        object lock):
+        rng_state *state, double_rand_func func,
+        double_array_rand_func array_func, object shape, object out,
+        object lock, size_t n_threads, size_t parallel_threshold):
     cdef np.ndarray values
+    cdef ChunkedArrayFill fill
     cdef double* values_data
-    cdef int values_size_is_odd
-    cdef size_t values_size, values_size_even, i
-    cdef double value_1, value_2
-    if shape is not None:
-        values = <np.ndarray>np.empty(shape=shape, dtype=np.float64)
+    cdef size_t values_size
+    if shape is not None or out is not None:
+        values, target, result = prepare_values(shape, out, np.float64)
         values_data = <double*>values.data
         values_size = <size_t>values.size
-        values_size_is_odd = <int>(values_size & 1)
-        values_size_even = values_size - values_size_is_odd
+        # chunks are split assuming values of each draw pair up among
+        # themselves, which does not hold with a spare value carried
+        if state.carry_normals == 0 and use_parallel_fill(
+                values_size, n_threads, parallel_threshold):
+            fill = ChunkedArrayFill()
+            fill.double_array_func = array_func
+            with lock:
+                fill_array_parallel(
+                    state, values, fill, 2, True, n_threads)
+        else:
+            with lock, nogil:
+                array_func(state, values_data, values_size)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
+    else:
         with lock, nogil:
-            if state.reversed == 0:
-                for i in range(0, values_size_even, 2):
-                    func(state, &values_data[i], &values_data[i + 1])
-                if values_size_is_odd:
-                    func(state, &values_data[values_size - 1], &value_1)
-            else:
-                if values_size_is_odd:
-                    func(state, &values_data[values_size - 1], &value_1)
-                for i in range(values_size_even - 1, -1, -2):
-                    func(state, &values_data[i - 1], &values_data[i])
-        return values
+            value = func(state)
+        return value
+
+
+cdef object assign_random_float_array(
+        rng_state *state, float_rand_func func,
+        float_array_rand_func array_func, object shape, object out,
+        object lock, size_t n_threads, size_t parallel_threshold):
+    cdef np.ndarray values
+    cdef ChunkedArrayFill fill
+    cdef float* values_data
+    cdef size_t values_size
+    if shape is not None or out is not None:
+        values, target, result = prepare_values(shape, out, np.float32)
+        values_data = <float*>values.data
+        values_size = <size_t>values.size
+        if use_parallel_fill(values_size, n_threads, parallel_threshold):
+            fill = ChunkedArrayFill()
+            fill.float_array_func = array_func
+            with lock:
+                fill_array_parallel(
+                    state, values, fill, 1, False, n_threads)
+        else:
+            with lock, nogil:
+                array_func(state, values_data, values_size)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
+    else:
+        with lock, nogil:
+            value = func(state)
+        return value
+
+
+cdef object assign_random_float_pair_array(
+        rng_state *state, float_pair_rand_func func,
+        float_array_rand_func array_func, object shape, object out,
+        object lock, size_t n_threads, size_t parallel_threshold):
+    cdef np.ndarray values
+    cdef ChunkedArrayFill fill
+    cdef float* values_data
+    cdef size_t values_size
+    cdef float value_1, value_2
+    if shape is not None or out is not None:
+        values, target, result = prepare_values(shape, out, np.float32)
+        values_data = <float*>values.data
+        values_size = <size_t>values.size
+        if use_parallel_fill(values_size, n_threads, parallel_threshold):
+            fill = ChunkedArrayFill()
+            fill.float_array_func = array_func
+            with lock:
+                fill_array_parallel(
+                    state, values, fill, 1, True, n_threads)
+        else:
+            with lock, nogil:
+                array_func(state, values_data, values_size)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
     else:
         with lock, nogil:
             func(state, &value_1, &value_2)
         return value_1
 
 
+cdef uint64_t bernoulli_fixed_point(object p) except? 0:
+    """Returns probability p rounded to a multiple of 2**-32 times 2**32."""
+    p = float(p)
+    if not 0. <= p <= 1.:
+        raise ValueError("p must be in range [0, 1].")
+    return <uint64_t>round(p * 2**32)
+
+
+# names of generators of key blocks selectable with the engine option
+ENGINES = {'mt19937': ENGINE_MT19937, 'philox': ENGINE_PHILOX}
+ENGINE_NAMES = dict((code, name) for name, code in ENGINES.items())
+
+
+cdef class NullLock:
+    """ Context manager with the interface of a lock which does nothing. """
+
+    def __enter__(self):
+        pass
+
+    def __exit__(self, *args):
+        pass
+
+
 cdef class ReversibleRandomState:
     """ Numpy-compatible reversible random number generator. """
 
-    cdef rng_state *internal_state
-    cdef object lock
-
-    def __cinit__(self, seed):
+    def __cinit__(self, seed, *args, **kwargs):
         self.internal_state = <rng_state*> PyMem_Malloc(sizeof(rng_state))
+        if self.internal_state == NULL:
+            raise MemoryError()
+        self.interface.state = self.internal_state
+        self.cursor = NULL
+        self.lookahead = NULL
+        self.checkpoints.keys = NULL
+        self.checkpoints.tags = NULL
+        self.checkpoints.capacity = 0
+        self.cursor_checkpoints.keys = NULL
+        self.cursor_checkpoints.tags = NULL
+        self.cursor_checkpoints.capacity = 0
+        self.interface.random_int32 = random_int32
+        self.interface.random_int64 = random_int64
+        self.interface.random_bounded = random_bounded
+        self.interface.random_uniform = random_uniform
+        self.interface.random_uniform_float = random_uniform_float
+        self.interface.random_normal_pair = random_normal_pair
+        self.interface.random_normal_icdf = random_normal_icdf
+        self.interface.reverse = reverse
+        self.interface.jump = jump
 
-    def __init__(self, seed):
+    def __init__(self, seed, n_threads=1, parallel_threshold=2**22,
+                 thread_safe=True, checkpoint_memory=0, lookahead=False,
+                 engine='mt19937', carry_normals=False):
         """
         Reversible random number generator.
 
@@ -133,19 +518,179 @@ cdef class ReversibleRandomState:
         ----------
         seed : int
             Integer seed in range [0, 2**32 - 1].
+        n_threads : int
+            Number of threads to generate arrays of at least
+            `parallel_threshold` values with. Arrays generated in parallel
+            have exactly the same values and leave the generator in exactly
+            the same state as if generated serially.
+        parallel_threshold : int
+            Minimum array size to generate in parallel if `n_threads > 1`.
+            Each thread jumps a copy of the generator state to the start of
+            its chunk which takes of the order of a millisecond.
+        thread_safe : bool
+            Whether to serialise access to the generator state with a lock
+            so that a generator can be shared between threads (default). If
+            False no lock is used and scalar draws call the C generator
+            functions directly, which is considerably quicker but means the
+            generator must only be used from one thread at a time.
+        checkpoint_memory : int
+            Memory budget in bytes for a cache of keys saved at twist
+            boundaries (every 624 random integers), with each key using
+            about 2.5 kB. While generating in reverse, keys in the cache are
+            copied rather than recomputed, roughly halving the cost of
+            reversing repeatedly over the same stretch of twists up to the
+            cache capacity. The default of zero disables the cache. Values
+            generated are the same with or without the cache. Once
+            `value_at` or `fill_range` is called their cursor uses a second
+            cache of the same size.
+        lookahead : bool
+            Whether to keep a buffer for the key of the next block of 624
+            random integers, computed ahead of use by `prepare_block`, so
+            that the draw moving to that block copies the key rather than
+            twisting (default False). The buffer of about 2.5 kB is only
+            allocated if enabled. Values generated are the same with or
+            without lookahead.
+        engine : str
+            Generator of the blocks of 624 random integers, either `mt19937`
+            (default) for the Mersenne-Twister or `philox` for the
+            counter-based Philox4x32-10 generator. Philox computes each block
+            directly from the seed and block index, so jumps, streams and
+            `value_at` take O(1) rather than O(log n) time and reversing is
+            no more costly than generating forward, but generating a block
+            is around ten times slower than a Mersenne-Twister twist. The
+            two engines generate different values.
+        carry_normals : bool
+            Whether to keep the second value of the pair of normal values
+            generated for a scalar or odd sized `standard_normal` draw (with
+            the default `box_muller` method and float64 dtype) as a spare,
+            used by the next such draw, rather than discarding it (default
+            False). Successive draws then take consecutive values of one
+            sequence of pairs, halving the cost of drawing single normal
+            values. Reversal remains exact, with the spare restored on
+            `reverse`, provided no other values are drawn and the generator
+            is not jumped while a spare is held, i.e. after an odd total
+            number of normal values since one was last not held. Draws with
+            a spare carried are all generated serially.
 
         Raises
         ------
-            ValueError: Seed outside of [0, 2**32 - 1] specified.
+            ValueError: Seed outside of [0, 2**32 - 1], non-positive number
+                of threads, negative checkpoint memory or unknown engine
+                specified.
             TypeError: Non-integer seed.
         """
-        self.lock = Lock()
+        self.configure(
+            n_threads, parallel_threshold, thread_safe, checkpoint_memory,
+            lookahead, engine, carry_normals)
         self.seed(seed)
 
+    cdef object configure(self, n_threads, parallel_threshold, thread_safe,
+                          checkpoint_memory, lookahead, engine,
+                          carry_normals):
+        """Sets generator options other than seed as described in __init__."""
+        if n_threads < 1:
+            raise ValueError("Number of threads must be positive.")
+        if engine not in ENGINES:
+            raise ValueError("Unknown engine {0}.".format(engine))
+        if checkpoint_memory < 0:
+            raise ValueError("Checkpoint memory must be non-negative.")
+        capacity = checkpoint_memory // (
+            KEY_LENGTH * sizeof(uint32_t) + sizeof(long long))
+        if capacity > 0:
+            self.checkpoints.keys = <uint32_t*> PyMem_Malloc(
+                capacity * KEY_LENGTH * sizeof(uint32_t))
+            self.checkpoints.tags = <long long*> PyMem_Malloc(
+                capacity * sizeof(long long))
+            if self.checkpoints.keys == NULL or self.checkpoints.tags == NULL:
+                raise MemoryError()
+            self.checkpoints.capacity = capacity
+        self.n_threads = n_threads
+        self.parallel_threshold = parallel_threshold
+        self.thread_safe = thread_safe
+        if lookahead:
+            self.lookahead = <rng_lookahead*> PyMem_Malloc(
+                sizeof(rng_lookahead))
+            if self.lookahead == NULL:
+                raise MemoryError()
+        self.engine = ENGINES[engine]
+        self.carry_normals = carry_normals
+        self.lock = Lock() if thread_safe else NullLock()
+
+    cdef void seed_state(self, unsigned long seed, rng_state *state):
+        """Initialises state from seed with the generator engine."""
+        if self.engine == ENGINE_PHILOX:
+            init_philox_state(seed, state)
+        else:
+            init_state(seed, state)
+
     def __dealloc__(self):
         if self.internal_state != NULL:
             PyMem_Free(self.internal_state)
             self.internal_state = NULL
+        PyMem_Free(self.cursor)
+        PyMem_Free(self.lookahead)
+        PyMem_Free(self.checkpoints.keys)
+        PyMem_Free(self.checkpoints.tags)
+        PyMem_Free(self.cursor_checkpoints.keys)
+        PyMem_Free(self.cursor_checkpoints.tags)
+
+    cdef void attach_caches(self):
+        """
+        Clears checkpoint cache and lookahead, attaching those enabled, and
+        sets whether the state carries spare normal values.
+        """
+        self.internal_state.carry_normals = self.carry_normals
+        if self.checkpoints.capacity > 0:
+            clear_checkpoints(&self.checkpoints)
+            self.internal_state.checkpoints = &self.checkpoints
+        if self.lookahead != NULL:
+            clear_lookahead(self.lookahead)
+            self.internal_state.lookahead = self.lookahead
+        # seed may have changed so cursor is recreated on next use
+        PyMem_Free(self.cursor)
+        self.cursor = NULL
+
+    cdef rng_state *stream_cursor(self) except NULL:
+        """
+        Cursor state for value_at / fill_range, created on first use.
+
+        The cursor has its own checkpoint cache, as keys the generator saves
+        after moving before its initial key depend on the path taken and so
+        are not keys of the stream from the seed.
+        """
+        cdef size_t capacity = self.checkpoints.capacity
+        if self.cursor == NULL:
+            if capacity > 0 and self.cursor_checkpoints.capacity == 0:
+                self.cursor_checkpoints.keys = <uint32_t*> PyMem_Malloc(
+                    capacity * KEY_LENGTH * sizeof(uint32_t))
+                self.cursor_checkpoints.tags = <long long*> PyMem_Malloc(
+                    capacity * sizeof(long long))
+                if (self.cursor_checkpoints.keys == NULL or
+                        self.cursor_checkpoints.tags == NULL):
+                    raise MemoryError()
+                self.cursor_checkpoints.capacity = capacity
+            self.cursor = <rng_state*> PyMem_Malloc(sizeof(rng_state))
+            if self.cursor == NULL:
+                raise MemoryError()
+            self.seed_state(self.internal_state.seed, self.cursor)
+            if capacity > 0:
+                clear_checkpoints(&self.cursor_checkpoints)
+                self.cursor.checkpoints = &self.cursor_checkpoints
+        return self.cursor
+
+    @property
+    def capsule(self):
+        """
+        PyCapsule named `revrng.rng_interface` holding a pointer to a C
+        `rng_interface` table of the generator state and scalar generator
+        functions, for drawing values from other extension modules.
+
+        The table is owned by the generator, which must be kept alive while
+        the capsule is in use. Calls through the table bypass `lock`, which
+        callers should hold if the generator may be used by other threads.
+        """
+        return PyCapsule_New(
+            <void*>&self.interface, "revrng.rng_interface", NULL)
 
     def seed(self, seed):
         """
@@ -166,14 +711,22 @@ cdef class ReversibleRandomState:
             if seed > int(2**32 - 1) or seed < 0:
                 raise ValueError("Seed must be in integer in [0, 2**32 - 1].")
             with self.lock:
-                init_state(seed, self.internal_state)
+                self.seed_state(seed, self.internal_state)
+                self.attach_caches()
         except TypeError:
             raise TypeError("Seed must be an integer.")
 
-    def get_state(self):
+    def get_state(self, copy=True):
         """
         Get a dictionary representing the internal state of the generator.
 
+        Parameters
+        ----------
+        copy : bool
+            Whether to return a copy of the key (default) or a read-only
+            uint32 array view of the generator's key, which is not copied and
+            so changes as values are generated.
+
         Returns
         -------
         dict
@@ -188,32 +741,312 @@ cdef class ReversibleRandomState:
             n_twists:
                 number of twist operations perfomed (initial state defined as
                 zero, reverse twists decrement therefore can be negative)
+            engine:
+                name of generator of key blocks, `mt19937` or `philox`
+            spare_normal:
+                tuple of spare normal value held with `carry_normals` and
+                the value generated with it, or None if no spare is held
         """
-        cdef size_t i
-        cdef np.ndarray key = <np.ndarray>np.empty(KEY_LENGTH, np.uint)
+        cdef np.npy_intp key_length = KEY_LENGTH
+        cdef np.ndarray key
+        if copy:
+            key = np.empty(KEY_LENGTH, np.uint32)
+        else:
+            key = np.PyArray_SimpleNewFromData(
+                1, &key_length, np.NPY_UINT32,
+                <void*>self.internal_state.key)
+            # view keeps generator alive
+            np.set_array_base(key, self)
+            key.flags.writeable = False
         with self.lock:
+            if copy:
+                memcpy(key.data, self.internal_state.key,
+                       KEY_LENGTH * sizeof(uint32_t))
             seed = self.internal_state.seed
-            for i in range(KEY_LENGTH):
-                key[i] = self.internal_state.key[i]
             pos = self.internal_state.pos
             reversed = self.internal_state.reversed
             n_twists = self.internal_state.n_twists
-        key = <np.ndarray>np.asarray(key, np.uint32)
+            engine = ENGINE_NAMES[self.internal_state.engine]
+            spare_normal = None
+            if self.internal_state.has_spare_normal:
+                spare_normal = (self.internal_state.spare_normals[0],
+                                self.internal_state.spare_normals[1])
         return {
             'seed': seed,
             'key': key,
             'pos': pos,
             'reversed': reversed,
-            'n_twists': n_twists
+            'n_twists': n_twists,
+            'engine': engine,
+            'spare_normal': spare_normal
         }
 
+    def set_state(self, state):
+        """
+        Set the internal state of the generator from a dictionary.
+
+        Parameters
+        ----------
+        state : dict
+            State in the format returned by `get_state`.
+
+        Raises
+        ------
+            ValueError: Key of wrong size, position out of range, unknown
+                engine or spare normal value for a generator without
+                `carry_normals`.
+        """
+        cdef np.ndarray key = np.ascontiguousarray(state['key'], np.uint32)
+        cdef int pos = state['pos']
+        cdef int reversed = 1 if state['reversed'] else 0
+        cdef int engine
+        if key.size != KEY_LENGTH:
+            raise ValueError(
+                "Key must have {0} entries.".format(KEY_LENGTH))
+        # states saved before engines were added are Mersenne-Twister states
+        engine_name = state.get('engine', 'mt19937')
+        if engine_name not in ENGINES:
+            raise ValueError("Unknown engine {0}.".format(engine_name))
+        engine = ENGINES[engine_name]
+        if pos < -reversed or pos > KEY_LENGTH - reversed:
+            raise ValueError("Key position out of range for direction.")
+        spare_normal = state.get('spare_normal')
+        if spare_normal is not None and not self.carry_normals:
+            raise ValueError(
+                "Spare normal value requires generator with carry_normals.")
+        with self.lock:
+            memcpy(self.internal_state.key, key.data,
+                   KEY_LENGTH * sizeof(uint32_t))
+            self.internal_state.seed = state['seed']
+            self.internal_state.pos = pos
+            self.internal_state.reversed = reversed
+            self.internal_state.n_twists = state['n_twists']
+            self.internal_state.engine = self.engine = engine
+            self.attach_caches()
+            self.internal_state.has_spare_normal = spare_normal is not None
+            if spare_normal is not None:
+                self.internal_state.spare_normals[0] = spare_normal[0]
+                self.internal_state.spare_normals[1] = spare_normal[1]
+            reset_counters(self.internal_state)
+
+    def __reduce__(self):
+        return (
+            ReversibleRandomState,
+            (self.internal_state.seed, self.n_threads,
+             self.parallel_threshold, self.thread_safe,
+             self.checkpoints.capacity * (
+                 KEY_LENGTH * sizeof(uint32_t) + sizeof(long long)),
+             self.lookahead != NULL, ENGINE_NAMES[self.engine],
+             self.carry_normals),
+            self.get_state()
+        )
+
+    def __setstate__(self, state):
+        self.set_state(state)
+
     def reverse(self):
         """
         Reverse direction of random number generator updates.
         """
-        reverse(self.internal_state)
+        with self.lock:
+            reverse(self.internal_state)
+
+    def prepare_block(self):
+        """
+        Compute the key of the next block of random integers in the current
+        direction in to the lookahead buffer.
+
+        The next draw to move to that block then copies the prepared key
+        rather than twisting. Intended to be called when the generator is
+        otherwise idle or from a background thread (the GIL is released
+        while the key is computed) to take twisting off the critical path of
+        latency sensitive draws. Has no effect if the buffer already holds
+        the key, and a prepared key is ignored if the generator moves
+        elsewhere (e.g. by reversing) before using it.
+
+        Raises
+        ------
+            RuntimeError: Generator created without lookahead enabled.
+        """
+        if self.lookahead == NULL:
+            raise RuntimeError(
+                "Lookahead not enabled: create with lookahead=True.")
+        with self.lock, nogil:
+            prepare_block(self.internal_state, self.lookahead)
+
+    @property
+    def counters(self):
+        """
+        Dictionary of counts of generator work since the state was seeded,
+        set or its counters reset.
+
+        Counters are only updated if the extension is built with the
+        `REVRAND_COUNTERS` C macro defined, for example by setting the
+        environment variable `REVRNG_COUNTERS=1` when running `setup.py`.
+
+        Returns
+        -------
+        dict
+            twists:
+                number of forward twists of key computed
+            reverse_twists:
+                number of reverse twists of key computed
+            checkpoint_loads:
+                number of reverse twists loaded from checkpoint cache
+            lookahead_loads:
+                number of twists or reverse twists loaded from lookahead
+                buffer prepared by `prepare_block`
+            jumps:
+                number of polynomial jumps of key (by `jump` or
+                `independent_streams`)
+            forward_words:
+                number of random integers drawn in forward direction
+            reverse_words:
+                number of random integers drawn in reverse direction
+            reversals:
+                number of calls to `reverse`
+
+        Raises
+        ------
+            RuntimeError: Extension built without counters enabled.
+        """
+        cdef rng_counters counters
+        if not counters_enabled():
+            raise RuntimeError(
+                "Counters not enabled: rebuild with REVRNG_COUNTERS=1 set.")
+        with self.lock:
+            get_counters(self.internal_state, &counters)
+        return {
+            'twists': counters.twists,
+            'reverse_twists': counters.reverse_twists,
+            'checkpoint_loads': counters.checkpoint_loads,
+            'lookahead_loads': counters.lookahead_loads,
+            'jumps': counters.jumps,
+            'forward_words': counters.forward_words,
+            'reverse_words': counters.reverse_words,
+            'reversals': counters.reversals
+        }
+
+    def reset_counters(self):
+        """
+        Zero all counts of generator work in `counters`.
+        """
+        with self.lock:
+            reset_counters(self.internal_state)
+
+    def jump(self, n):
+        """
+        Jump state of random number generator by a number of random integers.
+
+        For `n >= 0` equivalent to generating and discarding `n` values with
+        `random_int32` in the current direction. For `n < 0` equivalent to
+        reversing, jumping by `-n` and reversing again, i.e. rewinding the
+        last `-n` generated values. Large jumps require O(log |n|) operations
+        rather than generating the skipped values.
+
+        Note that each float64 `standard_uniform` value uses two random
+        integers and each pair of float64 `standard_normal` values (in the
+        default `box_muller` method) four, i.e. two per value. Float32
+        `standard_uniform` and `standard_normal` values use one random
+        integer per value.
+
+        Parameters
+        ----------
+        n : int
+            Number of random integers to jump by.
+        """
+        cdef long long n_ = n
+        with self.lock, nogil:
+            jump(self.internal_state, n_)
+
+    def value_at(self, k):
+        """
+        Random integer at position `k` of the stream generated from the seed.
+
+        Equal to the value of the `(k + 1)`th call to `random_int32` after
+        seeding, but found without changing the generator state or
+        generating the preceding values. A separate cursor state is moved to
+        the position by a polynomial jump, or a few twists for positions
+        near the last accessed, taking key blocks from its own checkpoint
+        cache if enabled by `checkpoint_memory`.
+
+        Each `standard_uniform` value `i` uses the integers at positions
+        `2 * i` and `2 * i + 1`.
+
+        Parameters
+        ----------
+        k : int
+            Non-negative position in stream.
+
+        Returns
+        -------
+        int
+            Random integer at position.
+
+        Raises
+        ------
+            ValueError: Negative position.
+        """
+        cdef long long k_ = k
+        cdef uint32_t value
+        cdef rng_state *cursor
+        if k_ < 0:
+            raise ValueError("Stream position must be non-negative.")
+        with self.lock:
+            cursor = self.stream_cursor()
+            with nogil:
+                value = value_at(cursor, k_)
+        return value
+
+    def fill_range(self, k0, k1, out=None):
+        """
+        Random integers at positions `k0` to `k1 - 1` of the stream generated
+        from the seed, as `value_at` for each position.
+
+        The cursor is moved once to `k0` and the values then generated in
+        bulk, without changing the generator state.
+
+        Parameters
+        ----------
+        k0 : int
+            Non-negative position of first value.
+        k1 : int
+            Position after last value, at least `k0`.
+        out : ndarray or None
+            Optional writeable array (or buffer) of size `k1 - k0` and of an
+            integer dtype such as uint32 to generate values in to.
+
+        Returns
+        -------
+        ndarray
+            Generated uint32 values (out if specified).
 
-    def random_int32(self, shape=None):
+        Raises
+        ------
+            ValueError: Invalid positions, non-writeable out or out of wrong
+                size.
+            TypeError: Generated values not castable to out dtype.
+        """
+        cdef long long k0_ = k0, k1_ = k1
+        cdef np.ndarray values
+        cdef uint32_t *values_data
+        cdef rng_state *cursor
+        if k0_ < 0 or k1_ < k0_:
+            raise ValueError("Positions must satisfy 0 <= k0 <= k1.")
+        values, target, result = prepare_values(
+            (k1_ - k0_,) if out is None else None, out, np.uint32)
+        if values.size != k1_ - k0_:
+            raise ValueError("Output array size does not match range.")
+        values_data = <uint32_t*>values.data
+        with self.lock:
+            cursor = self.stream_cursor()
+            with nogil:
+                fill_range(cursor, k0_, k1_, values_data)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
+
+    def random_int32(self, shape=None, out=None, dtype=np.uint64):
         """
         Generate array of random integers uniformly distributed on [0, 2**32).
 
@@ -221,60 +1054,748 @@ cdef class ReversibleRandomState:
         ----------
         shape : tuple or None
             Shape (dimensions) of generated array or None to return scalar.
+        out : ndarray or None
+            Optional writeable array (or buffer) of an integer dtype such as
+            uint32 or uint64 to generate samples in to, with same ordering as
+            for a new array. If specified shape must be None or match the
+            shape of out.
+        dtype : dtype
+            Integer dtype of generated array, either uint64 (default) to
+            store each 32-bit value widened to 64 bits or uint32 to store the
+            values packed. The values generated are the same in both cases.
+
+        Returns
+        -------
+        ndarray or int
+            Generated samples (out if specified).
+
+        Raises
+        ------
+            ValueError: Unsupported dtype, non-writeable out or shape not
+                matching out shape.
+            TypeError: Generated values not castable to out dtype.
+        """
+        if not self.thread_safe and shape is None and out is None:
+            return random_int32(self.internal_state)
+        dtype = np.dtype(dtype)
+        if dtype == np.uint64:
+            values = assign_random_ulong_array(
+                self.internal_state, random_int32, random_int32_array, shape,
+                out, self.lock, self.n_threads, self.parallel_threshold
+            )
+        elif dtype == np.uint32:
+            values = assign_random_uint32_array(
+                self.internal_state, random_int32, random_uint32_array,
+                shape, out, self.lock, self.n_threads, self.parallel_threshold
+            )
+        else:
+            raise ValueError("dtype must be uint64 or uint32.")
+        if shape is None and out is None:
+            return int(values)
+        else:
+            return values
+
+    def random_int64(self, shape=None, out=None):
+        """
+        Generate array of random integers uniformly distributed on [0, 2**64).
+
+        Each value packs two consecutive 32-bit random integers, with the
+        first generated in the forward direction as the upper 32 bits, so
+        reversing and sampling again returns the same values.
+
+        Parameters
+        ----------
+        shape : tuple or None
+            Shape (dimensions) of generated array or None to return scalar.
+        out : ndarray or None
+            Optional writeable array (or buffer) of an integer dtype such as
+            uint64 to generate samples in to, with same ordering as for a new
+            array. If specified shape must be None or match the shape of out.
 
         Returns
         -------
         ndarray or int
-            Generated samples.
+            Generated samples (out if specified).
+
+        Raises
+        ------
+            ValueError: Non-writeable out or shape not matching out shape.
+            TypeError: Generated values not castable to out dtype.
         """
-        values = assign_random_ulong_array(
-            self.internal_state, random_int32, shape, self.lock
+        if not self.thread_safe and shape is None and out is None:
+            return random_int64(self.internal_state)
+        values = assign_random_uint64_array(
+            self.internal_state, random_int64, random_int64_array, shape,
+            out, self.lock, self.n_threads, self.parallel_threshold
         )
-        if shape is None:
+        if shape is None and out is None:
             return int(values)
         else:
             return values
 
-    def standard_uniform(self, shape=None):
+    def random_integer(self, n, shape=None, out=None):
         """
-        Generate array of random double-precision floating point values
-        uniformly distributed on [0, 1).
+        Generate array of random integers uniformly distributed on [0, n).
+
+        Each value is computed from a 64-bit random integer composed of two
+        32-bit random integers by multiply-shift reduction, without rejection
+        so the number of random integers used is fixed and the draws are
+        reversible. The relative bias in the probability of each value is
+        below n / 2**64 <= 2**-32.
 
         Parameters
         ----------
+        n : int
+            Exclusive upper bound of values, with 1 <= n <= 2**32.
         shape : tuple or None
             Shape (dimensions) of generated array or None to return scalar.
+        out : ndarray or None
+            Optional writeable array (or buffer) of an integer dtype such as
+            uint32 or int64 to generate samples in to, with same ordering as
+            for a new array. If specified shape must be None or match the
+            shape of out.
 
         Returns
         -------
-        ndarray or float
-            Generated samples.
+        ndarray or int
+            Generated samples as uint32 array (out if specified).
+
+        Raises
+        ------
+            ValueError: n out of range, non-writeable out or shape not
+                matching out shape.
+            TypeError: Generated values not castable to out dtype.
         """
-        return assign_random_double_array(
-            self.internal_state, random_uniform, shape, self.lock
+        n = int(n)
+        if n < 1 or n > 2**32:
+            raise ValueError("n must be in range [1, 2**32].")
+        values = assign_random_uint32_param_array(
+            self.internal_state, n, random_bounded_array, 2, shape, out,
+            self.lock, self.n_threads, self.parallel_threshold
         )
+        if shape is None and out is None:
+            return int(values)
+        else:
+            return values
 
-    def standard_normal(self, shape=None):
+    def bernoulli_masks(self, p, shape=None, out=None):
         """
-        Generate array of random double-precision floating point values
-        from zero mean, unit variance normal distribution.
+        Generate array of masks of 32 independent Bernoulli variables.
 
-        Note that the normal samples are always generated in pairs - if an
-        array of odd overall size (or single scalar value) is specified, one
-        normal sample will be discarded (with reversibility maintained).
-        Therefore sampling many individual normal values will be relatively
-        inefficient.
+        Each bit of each uint32 mask is set independently with probability p
+        (rounded to a multiple of 2**-32). Each mask uses a fixed number of
+        random integers equal to the number of significant bits in the
+        binary expansion of the rounded p, for example one for p = 0.5, two
+        for p = 0.25 or 0.75 and at most 32, with none used for p = 0 or 1.
 
         Parameters
         ----------
+        p : float
+            Probability of each bit being set, with 0 <= p <= 1.
         shape : tuple or None
             Shape (dimensions) of generated array or None to return scalar.
+        out : ndarray or None
+            Optional writeable array (or buffer) of an integer dtype such as
+            uint32 to generate masks in to, with same ordering as for a new
+            array. If specified shape must be None or match the shape of out.
 
         Returns
         -------
-        ndarray or float
-            Generated samples.
+        ndarray or int
+            Generated masks as uint32 array (out if specified).
+
+        Raises
+        ------
+            ValueError: p out of range, non-writeable out or shape not
+                matching out shape.
+            TypeError: Generated masks not castable to out dtype.
         """
-        return assign_random_double_pair_array(
-            self.internal_state, random_normal_pair, shape, self.lock
+        cdef uint64_t p_fixed = bernoulli_fixed_point(p)
+        values = assign_random_uint32_param_array(
+            self.internal_state, p_fixed, random_bernoulli_masks,
+            bernoulli_words(p_fixed), shape, out, self.lock, self.n_threads,
+            self.parallel_threshold
         )
+        if shape is None and out is None:
+            return int(values)
+        else:
+            return values
+
+    def bernoulli(self, p, shape=None):
+        """
+        Generate array of independent Bernoulli variables.
+
+        Values are unpacked from the bits of the minimal number of masks
+        generated by `bernoulli_masks`, least significant bit first, so the
+        random integers used are shared between 32 values. For single
+        accept / reject decisions with arbitrary p, comparing a
+        `standard_uniform` sample to p uses fewer random integers.
+
+        Parameters
+        ----------
+        p : float
+            Probability of each value being True, with 0 <= p <= 1.
+        shape : tuple or None
+            Shape (dimensions) of generated array or None to return scalar.
+
+        Returns
+        -------
+        ndarray or bool
+            Generated samples as bool array.
+
+        Raises
+        ------
+            ValueError: p out of range.
+        """
+        size = 1 if shape is None else int(np.prod(shape))
+        masks = self.bernoulli_masks(p, (size + 31) // 32)
+        bits = (masks[:, None] >> np.arange(32, dtype=np.uint32)) & 1
+        values = bits.astype(np.bool_).ravel()[:size]
+        if shape is None:
+            return bool(values[0])
+        else:
+            return values.reshape(shape)
+
+    def standard_uniform(self, shape=None, out=None, dtype=np.float64):
+        """
+        Generate array of random floating point values uniformly distributed
+        on [0, 1).
+
+        Double-precision (float64) values use two random integers each and
+        have a 53-bit resolution. Single-precision (float32) values use one
+        random integer each and have a 24-bit resolution.
+
+        Parameters
+        ----------
+        shape : tuple or None
+            Shape (dimensions) of generated array or None to return scalar.
+        out : ndarray or None
+            Optional writeable array (or buffer) of a floating point dtype
+            such as float64 to generate samples in to, with same ordering as
+            for a new array. If specified shape must be None or match the
+            shape of out.
+        dtype : dtype
+            Floating point dtype of samples, either float64 (default) or
+            float32.
+
+        Returns
+        -------
+        ndarray or float
+            Generated samples (out if specified).
+
+        Raises
+        ------
+            ValueError: Unsupported dtype, non-writeable out or shape not
+                matching out shape specified.
+            TypeError: Generated values not castable to out dtype.
+        """
+        if (not self.thread_safe and shape is None and out is None and
+                dtype is np.float64):
+            return random_uniform(self.internal_state)
+        dtype = np.dtype(dtype)
+        if dtype == np.float64:
+            return assign_random_double_array(
+                self.internal_state, random_uniform, random_uniform_array,
+                shape, out, self.lock, self.n_threads, self.parallel_threshold
+            )
+        elif dtype == np.float32:
+            return assign_random_float_array(
+                self.internal_state, random_uniform_float,
+                random_uniform_float_array, shape, out, self.lock,
+                self.n_threads, self.parallel_threshold
+            )
+        else:
+            raise ValueError("dtype must be float64 or float32.")
+
+    def standard_normal(self, shape=None, method='box_muller', out=None,
+                        dtype=np.float64):
+        """
+        Generate array of random floating point values from zero mean, unit
+        variance normal distribution.
+
+        With the default `box_muller` method the normal samples are always
+        generated in pairs - if an array of odd overall size (or single scalar
+        value) is specified, one normal sample will be discarded (with
+        reversibility maintained). Therefore sampling many individual normal
+        values will be relatively inefficient, unless the generator was
+        created with `carry_normals=True` in which case the float64 sample is
+        instead kept as a spare for the next draw. The `inverse_cdf` method
+        instead transforms a single uniform value per sample, and is intended
+        as a low latency option for scalar or small odd sized draws - for
+        large arrays it is around 1.5 times slower than `box_muller`. The
+        two methods generate different values.
+
+        Single-precision (float32) values are only available with the
+        `box_muller` method, and are generated from pairs of single-precision
+        uniform values so using half as many random integers. Due to the
+        24-bit resolution of the uniform values their absolute values are
+        bounded above by sqrt(48 log(2)) ~= 5.77.
+
+        Parameters
+        ----------
+        shape : tuple or None
+            Shape (dimensions) of generated array or None to return scalar.
+        method : str
+            Method used to generate samples, either `box_muller` (default) or
+            `inverse_cdf`.
+        out : ndarray or None
+            Optional writeable array (or buffer) of a floating point dtype
+            such as float64 to generate samples in to, with same ordering as
+            for a new array. If specified shape must be None or match the
+            shape of out.
+        dtype : dtype
+            Floating point dtype of samples, either float64 (default) or
+            float32.
+
+        Returns
+        -------
+        ndarray or float
+            Generated samples (out if specified).
+
+        Raises
+        ------
+            ValueError: Unknown method, unsupported dtype (for method),
+                non-writeable out or shape not matching out shape specified.
+            TypeError: Generated values not castable to out dtype.
+        """
+        if (not self.thread_safe and shape is None and out is None and
+                dtype is np.float64):
+            if method == 'box_muller':
+                return random_normal(self.internal_state)
+            elif method == 'inverse_cdf':
+                return random_normal_icdf(self.internal_state)
+        dtype = np.dtype(dtype)
+        if dtype != np.float64 and dtype != np.float32:
+            raise ValueError("dtype must be float64 or float32.")
+        if method == 'box_muller' and dtype == np.float32:
+            return assign_random_float_pair_array(
+                self.internal_state, random_normal_float_pair,
+                random_normal_float_array, shape, out, self.lock,
+                self.n_threads, self.parallel_threshold
+            )
+        elif method == 'box_muller':
+            return assign_random_double_pair_array(
+                self.internal_state, random_normal, random_normal_array,
+                shape, out, self.lock, self.n_threads, self.parallel_threshold
+            )
+        elif method == 'inverse_cdf' and dtype == np.float32:
+            raise ValueError("dtype float32 not supported for inverse_cdf.")
+        elif method == 'inverse_cdf':
+            return assign_random_double_array(
+                self.internal_state, random_normal_icdf,
+                random_normal_icdf_array, shape, out, self.lock,
+                self.n_threads, self.parallel_threshold
+            )
+        else:
+            raise ValueError(
+                "Method must be one of 'box_muller' or 'inverse_cdf'.")
+
+    def multivariate_normal(self, mean, chol, n=None, out=None):
+        """
+        Generate random vectors from a multivariate normal distribution.
+
+        Each vector is `mean + chol @ z` for a vector `z` of standard normal
+        values, with the values of `z` for all vectors equal to those of
+        `standard_normal((n, dim))` (with the default `box_muller` method).
+        The normal values are generated and transformed in blocks, avoiding
+        the intermediate array and second pass of computing this explicitly.
+        As for `standard_normal`, after reversing the generator a draw of the
+        same number of vectors regenerates the last forward draw.
+
+        Parameters
+        ----------
+        mean : array_like
+            Mean vector of length `dim`.
+        chol : array_like
+            Lower-triangular Cholesky factor of covariance matrix, of shape
+            `(dim, dim)`. Entries above the diagonal are not read.
+        n : int or None
+            Number of vectors to generate, or None to generate a single
+            vector (or as many as fill out if specified).
+        out : ndarray or None
+            Optional writeable array (or buffer) of a floating point dtype
+            such as float64 with last dimension `dim` to generate vectors in
+            to. If specified with `n`, must be of shape `(n, dim)`.
+
+        Returns
+        -------
+        ndarray
+            Generated vectors, of shape `(dim,)` or `(n, dim)` if out is not
+            specified (out if specified).
+
+        Raises
+        ------
+            ValueError: mean not one-dimensional, chol not of shape
+                `(dim, dim)`, non-writeable out or out of wrong shape.
+            TypeError: Generated values not castable to out dtype.
+        """
+        cdef np.ndarray mean_array, chol_array, values
+        cdef size_t dim, n_vectors
+        cdef double *values_data
+        mean_array = np.ascontiguousarray(mean, np.float64)
+        chol_array = np.ascontiguousarray(chol, np.float64)
+        if mean_array.ndim != 1:
+            raise ValueError("mean must be one-dimensional.")
+        dim = <size_t>mean_array.shape[0]
+        if chol_array.ndim != 2 or chol_array.shape[0] != dim or (
+                chol_array.shape[1] != dim):
+            raise ValueError("chol must be of shape ({0}, {0}).".format(dim))
+        if n is not None:
+            shape = (n, dim)
+        elif out is None:
+            shape = (dim,)
+        else:
+            shape = None
+        values, target, result = prepare_values(shape, out, np.float64)
+        if values.ndim == 0 or values.shape[values.ndim - 1] != dim:
+            raise ValueError(
+                "Output array last dimension must be {0}.".format(dim))
+        n_vectors = <size_t>values.size // dim if dim > 0 else 0
+        values_data = <double*>values.data
+        with self.lock, nogil:
+            random_multivariate_normal(
+                self.internal_state, dim, <double*>mean_array.data,
+                <double*>chol_array.data, values_data, n_vectors)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
+
+
+cdef class ReversibleRandomStateBatch:
+    """
+    Batch of reversible random number generators advancing in lockstep.
+
+    Each call draws one value from every generator (stream) in the batch in
+    to an array. The generator keys are stored interleaved, with word `i` of
+    all streams contiguous, so twists are vectorized across streams and a
+    draw for the whole batch is a single C call. Stream `s` generates exactly
+    the values of `ReversibleRandomState(seeds[s])` for the same sequence of
+    calls, with standard normal values generated by the `inverse_cdf` method
+    as it uses a fixed number of random integers per value.
+    """
+
+    def __cinit__(self, seeds, *args, **kwargs):
+        self.batch.keys = NULL
+        self.batch.seeds = NULL
+        self.batch.n_streams = 0
+
+    def __init__(self, seeds):
+        """
+        Batch of reversible random number generators.
+
+        Parameters
+        ----------
+        seeds : array_like
+            Integer seed in range [0, 2**32 - 1] for each stream.
+
+        Raises
+        ------
+            ValueError: Seed outside of [0, 2**32 - 1] or no seeds specified.
+            TypeError: Non-integer seeds.
+        """
+        cdef np.ndarray seeds_array = np.asarray(seeds).ravel()
+        cdef size_t n_streams = seeds_array.size
+        if n_streams == 0:
+            raise ValueError("At least one seed must be specified.")
+        if seeds_array.dtype.kind not in 'iu':
+            raise TypeError("Seeds must be integers.")
+        if seeds_array.min() < 0 or seeds_array.max() > 2**32 - 1:
+            raise ValueError("Seeds must be integers in [0, 2**32 - 1].")
+        seeds_array = np.ascontiguousarray(seeds_array, np.dtype('L'))
+        self.batch.keys = <uint32_t*> PyMem_Malloc(
+            n_streams * KEY_LENGTH * sizeof(uint32_t))
+        self.batch.seeds = <unsigned long*> PyMem_Malloc(
+            n_streams * sizeof(unsigned long))
+        if self.batch.keys == NULL or self.batch.seeds == NULL:
+            raise MemoryError()
+        self.batch.n_streams = n_streams
+        self.lock = Lock()
+        with nogil:
+            init_batch(<unsigned long*>seeds_array.data, &self.batch)
+
+    def __dealloc__(self):
+        PyMem_Free(self.batch.keys)
+        PyMem_Free(self.batch.seeds)
+
+    def __len__(self):
+        return self.batch.n_streams
+
+    def reverse(self):
+        """
+        Reverse direction of random number generator updates of all streams.
+        """
+        with self.lock:
+            reverse_batch(&self.batch)
+
+    def get_stream(self, s):
+        """
+        Get a copy of a stream of the batch as a ReversibleRandomState.
+
+        Parameters
+        ----------
+        s : int
+            Index of stream in batch.
+
+        Returns
+        -------
+        ReversibleRandomState
+            Generator in same state as the stream, which subsequently
+            generates the same values as the stream independently of it.
+
+        Raises
+        ------
+            IndexError: Stream index out of range.
+        """
+        cdef ReversibleRandomState state
+        cdef size_t s_
+        if s < 0 or s >= self.batch.n_streams:
+            raise IndexError("Stream index out of range.")
+        s_ = s
+        state = ReversibleRandomState(self.batch.seeds[s_])
+        with self.lock:
+            get_batch_state(&self.batch, s_, state.internal_state)
+        return state
+
+    def random_int32(self, out=None):
+        """
+        Generate one random integer uniformly distributed on [0, 2**32) for
+        each stream.
+
+        Parameters
+        ----------
+        out : ndarray or None
+            Optional writeable array (or buffer) of an integer dtype of size
+            equal to the number of streams to generate samples in to.
+
+        Returns
+        -------
+        ndarray
+            uint32 array of samples with entry `s` from stream `s` (out if
+            specified).
+
+        Raises
+        ------
+            ValueError: Non-writeable out or shape not matching batch size.
+            TypeError: Generated values not castable to out dtype.
+        """
+        values, target, result = prepare_values(
+            (self.batch.n_streams,), out, np.uint32)
+        cdef np.ndarray values_array = values
+        with self.lock, nogil:
+            random_int32_batch(&self.batch, <uint32_t*>values_array.data)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
+
+    def standard_uniform(self, out=None):
+        """
+        Generate one random floating point value uniformly distributed on
+        [0, 1) for each stream.
+
+        Parameters
+        ----------
+        out : ndarray or None
+            Optional writeable array (or buffer) of a floating point dtype of
+            size equal to the number of streams to generate samples in to.
+
+        Returns
+        -------
+        ndarray
+            float64 array of samples with entry `s` from stream `s` (out if
+            specified).
+
+        Raises
+        ------
+            ValueError: Non-writeable out or shape not matching batch size.
+            TypeError: Generated values not castable to out dtype.
+        """
+        values, target, result = prepare_values(
+            (self.batch.n_streams,), out, np.float64)
+        cdef np.ndarray values_array = values
+        with self.lock, nogil:
+            random_uniform_batch(&self.batch, <double*>values_array.data)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
+
+    def standard_normal(self, out=None):
+        """
+        Generate one random floating point value from the standard normal
+        distribution for each stream, by the `inverse_cdf` method.
+
+        Parameters
+        ----------
+        out : ndarray or None
+            Optional writeable array (or buffer) of a floating point dtype of
+            size equal to the number of streams to generate samples in to.
+
+        Returns
+        -------
+        ndarray
+            float64 array of samples with entry `s` from stream `s` (out if
+            specified).
+
+        Raises
+        ------
+            ValueError: Non-writeable out or shape not matching batch size.
+            TypeError: Generated values not castable to out dtype.
+        """
+        values, target, result = prepare_values(
+            (self.batch.n_streams,), out, np.float64)
+        cdef np.ndarray values_array = values
+        with self.lock, nogil:
+            random_normal_icdf_batch(
+                &self.batch, <double*>values_array.data)
+        if target is not None:
+            np.copyto(target, values, casting='same_kind')
+        return result
+
+
+def independent_streams(seed, n_streams, stream_twists=2**40, **kwargs):
+    """
+    Create reversible random number generators for independent streams.
+
+    Stream `i` starts from the state of a generator initialised with `seed`
+    after `i * stream_twists * 624` random integers, computed with polynomial
+    jumps, so the streams do not overlap for the first `stream_twists * 624`
+    random integers generated forward from each. Each stream has its own lock
+    and can be used and reversed independently of the others, for example
+    one per worker thread.
+
+    Parameters
+    ----------
+    seed : int
+        Integer seed in range [0, 2**32 - 1].
+    n_streams : int
+        Number of streams to create.
+    stream_twists : int
+        Number of 624 integer key twists separating consecutive streams.
+    **kwargs
+        Keyword arguments passed to the ReversibleRandomState constructor of
+        each stream, such as `thread_safe=False` for streams each used only
+        from their own thread.
+
+    Returns
+    -------
+    list of ReversibleRandomState
+        Generators for each stream.
+
+    Raises
+    ------
+        ValueError: Seed outside of [0, 2**32 - 1], negative number of
+            streams, non-positive stream separation or total stream length
+            too large to index specified.
+        TypeError: Non-integer seed.
+    """
+    cdef size_t i, n_streams_
+    cdef long long stream_twists_
+    cdef unsigned long seed_
+    cdef rng_state *states
+    cdef ReversibleRandomState stream
+    if n_streams < 0:
+        raise ValueError("Number of streams must be non-negative.")
+    if stream_twists < 1:
+        raise ValueError("Stream separation must be positive.")
+    if max(n_streams - 1, 0) * stream_twists * KEY_LENGTH > 2**62:
+        raise ValueError("Streams too long for number of streams.")
+    n_streams_ = n_streams
+    stream_twists_ = stream_twists
+    streams = [
+        ReversibleRandomState(seed, **kwargs) for i in range(n_streams_)
+    ]
+    if n_streams_ == 0:
+        return streams
+    states = <rng_state*> PyMem_Malloc(n_streams_ * sizeof(rng_state))
+    if states == NULL:
+        raise MemoryError()
+    try:
+        stream = streams[0]
+        seed_ = stream.internal_state.seed
+        if stream.engine == ENGINE_PHILOX:
+            # Philox jumps are O(1) so each stream is jumped from the first
+            for i in range(n_streams_):
+                states[i] = stream.internal_state[0]
+                with nogil:
+                    jump(&states[i],
+                         <long long> i * stream_twists_ * KEY_LENGTH)
+                    reset_counters(&states[i])
+        else:
+            with nogil:
+                init_streams(seed_, states, n_streams_, stream_twists_)
+        for i in range(n_streams_):
+            stream = streams[i]
+            stream.internal_state[0] = states[i]
+            stream.attach_caches()
+    finally:
+        PyMem_Free(states)
+    return streams
+
+
+def states_from_seeds(seeds, n_threads=1, parallel_threshold=2**22,
+                      thread_safe=True, checkpoint_memory=0, lookahead=False,
+                      engine='mt19937', carry_normals=False):
+    """
+    Create reversible random number generators from many integer seeds.
+
+    Equivalent to `[ReversibleRandomState(seed, ...) for seed in seeds]` but
+    with the states for all seeds initialised together in a single call,
+    interleaving the per-seed initialisation recurrences, so quicker when
+    creating many generators.
+
+    Parameters
+    ----------
+    seeds : array_like
+        Integer seeds in range [0, 2**32 - 1].
+    n_threads, parallel_threshold, thread_safe, checkpoint_memory, lookahead,
+    engine, carry_normals
+        Options of each generator as described for ReversibleRandomState.
+
+    Returns
+    -------
+    list of ReversibleRandomState
+        Generators for each seed.
+
+    Raises
+    ------
+        ValueError: Seed outside of [0, 2**32 - 1] or invalid options
+            specified.
+        TypeError: Non-integer seeds.
+    """
+    cdef size_t i, n_seeds
+    cdef np.ndarray seeds_array = np.asarray(seeds).ravel()
+    cdef rng_state *states
+    cdef ReversibleRandomState state
+    if seeds_array.size > 0 and seeds_array.dtype.kind not in 'iu':
+        raise TypeError("Seeds must be integers.")
+    if seeds_array.size > 0 and (
+            seeds_array.min() < 0 or seeds_array.max() > 2**32 - 1):
+        raise ValueError("Seeds must be integers in [0, 2**32 - 1].")
+    # C unsigned long array of seeds
+    seeds_array = np.ascontiguousarray(seeds_array, np.dtype('L'))
+    n_seeds = seeds_array.size
+    streams = []
+    if n_seeds == 0:
+        return streams
+    states = <rng_state*> PyMem_Malloc(n_seeds * sizeof(rng_state))
+    if states == NULL:
+        raise MemoryError()
+    try:
+        if engine == 'philox':
+            for i in range(n_seeds):
+                init_philox_state(
+                    (<unsigned long*>seeds_array.data)[i], &states[i])
+        else:
+            with nogil:
+                init_states(
+                    <unsigned long*>seeds_array.data, states, n_seeds)
+        for i in range(n_seeds):
+            state = ReversibleRandomState.__new__(ReversibleRandomState, 0)
+            state.configure(
+                n_threads, parallel_threshold, thread_safe, checkpoint_memory,
+                lookahead, engine, carry_normals)
+            state.internal_state[0] = states[i]
+            state.attach_caches()
+            streams.append(state)
+    finally:
+        PyMem_Free(states)
+    return streams
@@ -69,66 +69,434 @@
  * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Algorithm and constants used in the log_unit implementation from fdlibm.
+ *
+ * Copyright (C) 1993 by Sun Microsystems, Inc. All rights reserved.
+ *
+ * Developed at SunSoft, a Sun Microsystems, Inc. business.
+ * Permission to use, copy, modify, and distribute this
+ * software is freely granted, provided that this notice
+ * is preserved.
  */
 
 
 #include <math.h>
-#define PI 3.141592653589793238462643383279502884
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "revrand.h"
 
 /* 32-bit Mersenne-Twister (MT-19937) constants */
-#define KEY_LENGTH 624
+#define KEY_LENGTH REVRAND_KEY_LENGTH
 #define MID_OFFSET 397
 #define MATRIX_A 0x9908b0dfUL
 #define UPPER_MASK 0x80000000UL
 #define LOWER_MASK 0x7fffffffUL
-#define TEMPER_SHIFT_A 11
-#define TEMPER_SHIFT_B 7
-#define TEMPER_SHIFT_C 15
-#define TEMPER_SHIFT_D 18
-#define TEMPER_MASK_B 0x9d2c5680UL
-#define TEMPER_MASK_C 0xefc60000UL
+
+/*
+ * Where supported (GCC / Clang targeting x86-64 glibc) the vectorizable key
+ * update kernels are compiled for several instruction set extensions with the
+ * variant for the host CPU selected when the library is loaded. Elsewhere the
+ * kernels are vectorized for the baseline instruction set (e.g. SSE2 on
+ * x86-64 or NEON on AArch64). Define REVRAND_NO_DISPATCH to disable.
+ */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__GLIBC__) && \
+    defined(__has_attribute) && !defined(REVRAND_NO_DISPATCH)
+#if __has_attribute(target_clones)
+#define REVRAND_DISPATCH \
+    __attribute__((target_clones("avx512f", "avx2", "default")))
+#endif
+#endif
+#ifndef REVRAND_DISPATCH
+#define REVRAND_DISPATCH
+#endif
+
+/*
+ * Counts of generator work in rng_state are only updated if compiled with
+ * REVRAND_COUNTERS defined, so by default cost nothing beyond their storage.
+ */
+#ifdef REVRAND_COUNTERS
+#define COUNT(state, counter) ((state)->counters.counter++)
+#else
+#define COUNT(state, counter) ((void) 0)
+#endif
+
+/* Jump constants */
+#define JUMP_POLY_DEGREE 19937 /* degree of MT-19937 characteristic polynomial */
+#define JUMP_POLY_N_TERMS 134 /* number of non-leading polynomial terms */
+#define JUMP_POLY_WORDS 312 /* 64-bit words to hold polynomial remainders */
+#define JUMP_MIN_TWISTS 10000 /* fewer twists than this done directly */
+/* word index and bit mask of leading polynomial term in 64-bit words */
+#define JUMP_POLY_LEAD_WORD (JUMP_POLY_DEGREE >> 6)
+#define JUMP_POLY_LEAD_BIT ((uint64_t) 1 << (JUMP_POLY_DEGREE & 63))
+
+/*
+ * Philox4x32-10 constants of Salmon et al. (2011): round multipliers, Weyl
+ * sequence key increments and number of 4 word outputs per key block.
+ */
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+#define PHILOX_ROUNDS 10
+#define PHILOX_BLOCKS (KEY_LENGTH / 4)
 
 /* State initialisation constants */
 #define INIT_MULT 1812433253UL
 #define INIT_MASK 0xffffffffUL
+#define INIT_LANES 8 /* seeds initialised together by init_states */
+
+/* Batch constants */
+#define BATCH_LANES 16 /* streams reverse twisted together in batches */
+
+/* (int32, int32) -> double constants, shared with revrand_random_uniform */
+#define RAND_DBL_SHIFT_A REVRAND_DBL_SHIFT_A
+#define RAND_DBL_SHIFT_B REVRAND_DBL_SHIFT_B
+#define RAND_DBL_MUL REVRAND_DBL_MUL
+#define RAND_DBL_DIV REVRAND_DBL_DIV
+
+/* bounded integer and Bernoulli constants */
+#define BOUND_MAX 4294967296ULL /* 2^32: largest bound and fixed point one */
+#define BERNOULLI_CHUNK 64 /* masks generated per buffered chunk */
+
+/* int32 -> float constants, shared with revrand_random_uniform_float */
+#define RAND_FLT_SHIFT REVRAND_FLT_SHIFT
+#define RAND_FLT_DIV REVRAND_FLT_DIV
+
+/* fdlibm log constants: ln(2) split in to high and low parts */
+#define LOG_LN2_HI 6.93147180369123816490e-01 /* 3fe62e42 fee00000 */
+#define LOG_LN2_LO 1.90821492927058770002e-10 /* 3dea39ef 35793c76 */
+/* fdlibm log constants: polynomial approximation coefficients */
+#define LOG_LG1 6.666666666666735130e-01 /* 3FE55555 55555593 */
+#define LOG_LG2 3.999999999940941908e-01 /* 3FD99999 9997FA04 */
+#define LOG_LG3 2.857142874366239149e-01 /* 3FD24924 94229359 */
+#define LOG_LG4 2.222219843214978396e-01 /* 3FCC71C5 1D8E78AF */
+#define LOG_LG5 1.818357216161805012e-01 /* 3FC74664 96CB03DE */
+#define LOG_LG6 1.531383769920937332e-01 /* 3FC39A09 D078C69F */
+#define LOG_LG7 1.479819860511658591e-01 /* 3FC2F112 DF3E5244 */
+
+/* Wichura (1988) AS241 normal inverse CDF region boundaries */
+#define ICDF_SPLIT_Q 0.425
+#define ICDF_SPLIT_R 5.
+#define ICDF_CONST_R 0.180625
+#define ICDF_SHIFT_R 1.6
+
+/* Taylor series coefficients of sin(pi * d / 2) in odd powers of d */
+#define SIN_C0 1.5707963267948966
+#define SIN_C1 -0.6459640975062463
+#define SIN_C2 0.07969262624616705
+#define SIN_C3 -0.004681754135318688
+#define SIN_C4 0.00016044118478735983
+#define SIN_C5 -3.598843235212085e-06
+#define SIN_C6 5.692172921967927e-08
+#define SIN_C7 -6.688035109811468e-10
+#define SIN_C8 6.0669357311061955e-12
+/* Taylor series coefficients of cos(pi * d / 2) in even powers of d */
+#define COS_C1 -1.2337005501361697
+#define COS_C2 0.25366950790104803
+#define COS_C3 -0.02086348076335296
+#define COS_C4 0.0009192602748394266
+#define COS_C5 -2.5202042373060607e-05
+#define COS_C6 4.710874778818172e-07
+#define COS_C7 -6.386603083791852e-09
+#define COS_C8 6.565963114979473e-11
+
+#ifdef REVRAND_COUNTERS
+/* Stream index of the next random integer drawn in the current direction. */
+static long long word_index(const rng_state *state)
+{
+    return KEY_LENGTH * (state->n_twists - 1) + state->pos;
+}
+#endif
+
+/*
+ * Adds the random integers drawn since the word count was last restarted to
+ * the count for the current direction and restarts it.
+ *
+ * Within a run of draws in one direction the stream index moves by one per
+ * random integer, so words drawn are counted from the distance moved rather
+ * than in each generator function. The count is restarted at every change of
+ * direction and jump.
+ */
+static void count_words(rng_state *state)
+{
+#ifdef REVRAND_COUNTERS
+    long long index = word_index(state);
+    if (state->reversed == 0) {
+        state->counters.forward_words += index - state->counters.word_mark;
+    }
+    else {
+        state->counters.reverse_words += state->counters.word_mark - index;
+    }
+    state->counters.word_mark = index;
+#else
+    (void) state;
+#endif
+}
+
+/* Restarts the word count from the current position without counting. */
+static void restart_word_count(rng_state *state)
+{
+#ifdef REVRAND_COUNTERS
+    state->counters.word_mark = word_index(state);
+#else
+    (void) state;
+#endif
+}
+
+/* Non-zero if compiled with REVRAND_COUNTERS so counters are updated. */
+int revrand_counters_enabled(void)
+{
+#ifdef REVRAND_COUNTERS
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* Zeroes all counters of a state. */
+void revrand_reset_counters(rng_state *state)
+{
+    memset(&state->counters, 0, sizeof(rng_counters));
+    restart_word_count(state);
+}
 
-/* (int32, int32) -> double constants */
-#define RAND_DBL_SHIFT_A 5
-#define RAND_DBL_SHIFT_B 6
-#define RAND_DBL_MUL 67108864.0
-#define RAND_DBL_DIV 9007199254740992.0
-/* 67108864 = 0x4000000, 9007199254740992 = 0x20000000000000 */
+/* Copies counters of a state, including random integers drawn so far. */
+void revrand_get_counters(const rng_state *state, rng_counters *counters)
+{
+    rng_state copy;
+    copy.pos = state->pos;
+    copy.reversed = state->reversed;
+    copy.n_twists = state->n_twists;
+    copy.counters = state->counters;
+    count_words(&copy);
+    *counters = copy.counters;
+}
 
-/* Internal random number generator state. */
-typedef struct rng_state_
+/*
+ * Sets the counters of state to those of base plus the counts accumulated by
+ * each of n copies of base since they were copied, restarting the word count
+ * from the current position of state. Used to combine the work of copies of
+ * a state advanced separately (e.g. in parallel) in to the single state they
+ * are merged back in to.
+ */
+void revrand_merge_counters(rng_state *state, const rng_state *base,
+                            const rng_state *copies, size_t n)
 {
-    unsigned long seed; /* integer seed used to initialise state */
-    unsigned long key[KEY_LENGTH]; /* Mersenne-Twister state */
-    int pos; /* current position in key array */
-    int reversed; /* ==0: forward state updates, !=0: reverse state updates */
-    int n_twists; /* number of twists performed */
-} rng_state;
+    rng_counters total, before, after;
+    size_t i;
+    revrand_get_counters(base, &before);
+    total = before;
+    for (i = 0; i < n; i++) {
+        revrand_get_counters(&copies[i], &after);
+        total.twists += after.twists - before.twists;
+        total.reverse_twists += after.reverse_twists - before.reverse_twists;
+        total.checkpoint_loads +=
+            after.checkpoint_loads - before.checkpoint_loads;
+        total.lookahead_loads +=
+            after.lookahead_loads - before.lookahead_loads;
+        total.jumps += after.jumps - before.jumps;
+        total.forward_words += after.forward_words - before.forward_words;
+        total.reverse_words += after.reverse_words - before.reverse_words;
+        total.reversals += after.reversals - before.reversals;
+    }
+    state->counters = total;
+    restart_word_count(state);
+}
 
 /* Initialise generator state from an integer seed. */
-void init_state(unsigned long seed, rng_state *state)
+void revrand_init_state(unsigned long seed, rng_state *state)
 {
     int pos;
+    uint32_t value;
     seed &= INIT_MASK;
     state-> seed = seed;
+    /* 32-bit key entries so recurrence implicitly reduced modulo 2^32 */
+    value = (uint32_t) seed;
     for (pos = 0; pos < KEY_LENGTH; pos++) {
-        state->key[pos] = seed;
-        seed = (INIT_MULT * (seed ^ (seed >> 30)) + pos + 1) & INIT_MASK;
+        state->key[pos] = value;
+        value = INIT_MULT * (value ^ (value >> 30)) + pos + 1;
     }
     state->pos = KEY_LENGTH;
     state->reversed = 0;
     state->n_twists = 0;
+    state->engine = REVRAND_ENGINE_MT19937;
+    state->carry_normals = 0;
+    state->has_spare_normal = 0;
+    state->checkpoints = NULL;
+    state->lookahead = NULL;
+    revrand_reset_counters(state);
+}
+
+/*
+ * Initialises n states from an array of integer seeds, equivalent to calling
+ * init_state(seeds[i], &states[i]) for each i.
+ *
+ * The serial initialisation recurrence of each seed is interleaved across
+ * blocks of INIT_LANES seeds so that the recurrences of a block are evaluated
+ * together in vector lanes rather than one after another.
+ */
+REVRAND_DISPATCH
+void revrand_init_states(const unsigned long *seeds, rng_state *states,
+                         size_t n)
+{
+    size_t i, j, lanes;
+    int pos;
+    uint32_t values[INIT_LANES];
+    for (i = 0; i < n; i += INIT_LANES) {
+        lanes = n - i < INIT_LANES ? n - i : INIT_LANES;
+        for (j = 0; j < lanes; j++) {
+            states[i + j].seed = seeds[i + j] & INIT_MASK;
+            states[i + j].pos = KEY_LENGTH;
+            states[i + j].reversed = 0;
+            states[i + j].n_twists = 0;
+            states[i + j].engine = REVRAND_ENGINE_MT19937;
+            states[i + j].carry_normals = 0;
+            states[i + j].has_spare_normal = 0;
+            states[i + j].checkpoints = NULL;
+            states[i + j].lookahead = NULL;
+            revrand_reset_counters(&states[i + j]);
+            values[j] = (uint32_t) states[i + j].seed;
+        }
+        for (j = lanes; j < INIT_LANES; j++) {
+            values[j] = 0;
+        }
+        for (pos = 0; pos < KEY_LENGTH; pos++) {
+            for (j = 0; j < lanes; j++) {
+                states[i + j].key[pos] = values[j];
+            }
+            for (j = 0; j < INIT_LANES; j++) {
+                values[j] = INIT_MULT * (values[j] ^ (values[j] >> 30)) +
+                            pos + 1;
+            }
+        }
+    }
+}
+
+/*
+ * Inverts the Mersenne-Twister tempering transform, so that key values set to
+ * untemper(x) generate x. The right shift steps are inverted by iterating
+ * until all shifted bits are recovered, the masked left shift by 7 likewise,
+ * with the left shift by 15 inverted by a single step as the mask leaves the
+ * bits it depends on unchanged.
+ */
+static uint32_t untemper(uint32_t y)
+{
+    uint32_t t;
+    int i;
+    y ^= y >> REVRAND_TEMPER_SHIFT_D;
+    y ^= (y << REVRAND_TEMPER_SHIFT_C) & REVRAND_TEMPER_MASK_C;
+    t = y;
+    for (i = 0; i < 4; i++) {
+        t = y ^ ((t << REVRAND_TEMPER_SHIFT_B) & REVRAND_TEMPER_MASK_B);
+    }
+    y = t;
+    for (i = 0; i < 2; i++) {
+        t = y ^ (t >> REVRAND_TEMPER_SHIFT_A);
+    }
+    return t;
+}
+
+/*
+ * Sets key to block n_twists of the Philox4x32-10 stream of the state's seed:
+ * with the 64-bit key index (n_twists - 1) * PHILOX_BLOCKS + j (modulo 2^64)
+ * as the counter and the seed as the key, output j of the block cipher gives
+ * key values 4 * j to 4 * j + 3, untempered so that generated values are the
+ * Philox outputs unchanged.
+ *
+ * The outputs of a block are computed together with each round applied to
+ * all counters in turn so that the rounds are vectorized across counters.
+ */
+REVRAND_DISPATCH
+static void philox_block(rng_state *state, long long n_twists)
+{
+    uint32_t c0[PHILOX_BLOCKS], c1[PHILOX_BLOCKS];
+    uint32_t c2[PHILOX_BLOCKS], c3[PHILOX_BLOCKS];
+    uint32_t k0 = (uint32_t) state->seed, k1 = 0;
+    uint64_t index = (uint64_t) (n_twists - 1) * PHILOX_BLOCKS;
+    uint64_t p0, p1;
+    int j, r;
+    for (j = 0; j < PHILOX_BLOCKS; j++) {
+        c0[j] = (uint32_t) (index + j);
+        c1[j] = (uint32_t) ((index + j) >> 32);
+        c2[j] = 0;
+        c3[j] = 0;
+    }
+    for (r = 0; r < PHILOX_ROUNDS; r++) {
+        for (j = 0; j < PHILOX_BLOCKS; j++) {
+            p0 = (uint64_t) PHILOX_M0 * c0[j];
+            p1 = (uint64_t) PHILOX_M1 * c2[j];
+            c0[j] = (uint32_t) (p1 >> 32) ^ c1[j] ^ k0;
+            c2[j] = (uint32_t) (p0 >> 32) ^ c3[j] ^ k1;
+            c1[j] = (uint32_t) p1;
+            c3[j] = (uint32_t) p0;
+        }
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    for (j = 0; j < PHILOX_BLOCKS; j++) {
+        state->key[4 * j] = untemper(c0[j]);
+        state->key[4 * j + 1] = untemper(c1[j]);
+        state->key[4 * j + 2] = untemper(c2[j]);
+        state->key[4 * j + 3] = untemper(c3[j]);
+    }
+    state->n_twists = n_twists;
+}
+
+/* Initialise generator state from an integer seed, with Philox key blocks. */
+void revrand_init_philox_state(unsigned long seed, rng_state *state)
+{
+    revrand_init_state(seed, state);
+    state->engine = REVRAND_ENGINE_PHILOX;
+    philox_block(state, 0);
+}
+
+/* Moves key to next block, by twisting or computing next Philox block. */
+static void twist_block(rng_state *state)
+{
+    if (state->engine == REVRAND_ENGINE_PHILOX) {
+        philox_block(state, state->n_twists + 1);
+        COUNT(state, twists);
+    }
+    else {
+        revrand_twist(state);
+    }
+}
+
+/* Moves key to previous block, as reverse_twist or for Philox directly. */
+static void reverse_twist_block(rng_state *state)
+{
+    if (state->engine == REVRAND_ENGINE_PHILOX) {
+        philox_block(state, state->n_twists - 1);
+        COUNT(state, reverse_twists);
+    }
+    else {
+        revrand_reverse_twist(state);
+    }
+}
+
+/* Empties all slots of a checkpoint cache. */
+void revrand_clear_checkpoints(rng_checkpoints *checkpoints)
+{
+    size_t i;
+    for (i = 0; i < checkpoints->capacity; i++) {
+        checkpoints->tags[i] = -1;
+    }
+}
+
+/* Empties a lookahead buffer. */
+void revrand_clear_lookahead(rng_lookahead *lookahead)
+{
+    lookahead->tag = -1;
 }
 
 /* Optimised implementation of reference Mersenne-Twister from Random Kit. */
-void twist(rng_state *state)
+REVRAND_DISPATCH
+void revrand_twist(rng_state *state)
 {
     int i;
-    unsigned long y;
+    uint32_t y;
     for (i = 0; i < KEY_LENGTH - MID_OFFSET; i++) {
         y = (state->key[i] & UPPER_MASK) | (state->key[i+1] & LOWER_MASK);
         state->key[i] = state->key[i+MID_OFFSET] ^
@@ -144,39 +512,75 @@ void twist(rng_state *state)
     state->key[KEY_LENGTH - 1] = state->key[MID_OFFSET - 1] ^
                                  (y >> 1) ^ (-(y & 1) & MATRIX_A);
     state->n_twists++;
+    COUNT(state, twists);
+}
+
+/*
+ * Inverts the twist of a single key value.
+ *
+ * Given twisted ^ mid where twisted = mid ^ (y >> 1) ^ (-(y & 1) & MATRIX_A),
+ * recovers y = (key[i] & UPPER_MASK) | (key[i+1] & LOWER_MASK). As y >> 1 has
+ * its upper bit unset, the upper bit of the input indicates if y was odd.
+ */
+static uint32_t untwist(uint32_t tmp)
+{
+    uint32_t odd = (tmp & UPPER_MASK) >> 31;
+    tmp ^= (-odd & MATRIX_A);
+    return (tmp << 1) | odd;
 }
 
-/* Reverses twist of state i.e. reverse_twist(twist(state)) is identity map. */
-void reverse_twist(rng_state *state)
+/*
+ * Reverses twist of state i.e. reverse_twist(twist(state)) is identity map.
+ *
+ * Each inverted twist recovers the upper bit of key[i] and the lower bits of
+ * key[i+1]. Rather than a serial backwards loop, the inversion is done in two
+ * passes of independent updates (and so is vectorizable): the first recovers
+ * the entries whose twist depended only on twisted values, the second the
+ * entries whose twist depended on untwisted values recovered in the first.
+ */
+REVRAND_DISPATCH
+void revrand_reverse_twist(rng_state *state)
 {
-    int i, tmp, odd;
+    int i;
+    uint32_t y[KEY_LENGTH];
+    /* first pass: twist of key[i] for i >= KEY_LENGTH - MID_OFFSET */
+    for (i = KEY_LENGTH - MID_OFFSET; i < KEY_LENGTH - 1; i++) {
+        y[i] = untwist(state->key[i] ^
+                       state->key[i + MID_OFFSET - KEY_LENGTH]);
+    }
     /* set upper bit of last key entry */
-    tmp = state->key[KEY_LENGTH - 1] ^ state->key[MID_OFFSET - 1];
-    state->key[KEY_LENGTH - 1] = (tmp << 1) & UPPER_MASK;
-    /* partition loop over keys to avoid mod ops in index calculations */
-    for (i = KEY_LENGTH - 2; i > KEY_LENGTH - MID_OFFSET - 1; i--) {
-        tmp = state->key[i] ^ state->key[i + MID_OFFSET - KEY_LENGTH];
-        odd = (tmp & UPPER_MASK) == UPPER_MASK;
-        tmp ^= (-odd & MATRIX_A);
-        tmp = (tmp << 1) | odd;
-        state->key[i] = tmp & UPPER_MASK;
-        state->key[i + 1] |= tmp & LOWER_MASK;
-    }
-    for (; i > -1; i--) {
-        tmp = state->key[i] ^ state->key[i + MID_OFFSET];
-        odd = (tmp & UPPER_MASK) == UPPER_MASK;
-        tmp ^= (-odd & MATRIX_A);
-        tmp = (tmp << 1) | odd;
-        state->key[i] = tmp & UPPER_MASK;
-        state->key[i + 1] |= tmp & LOWER_MASK;
+    state->key[KEY_LENGTH - 1] =
+        (((state->key[KEY_LENGTH - 1] ^ state->key[MID_OFFSET - 1]) << 1) &
+         UPPER_MASK) | (y[KEY_LENGTH - 2] & LOWER_MASK);
+    for (i = KEY_LENGTH - MID_OFFSET + 1; i < KEY_LENGTH - 1; i++) {
+        state->key[i] = (y[i] & UPPER_MASK) | (y[i - 1] & LOWER_MASK);
+    }
+    /* second pass: twist of key[i] for i < KEY_LENGTH - MID_OFFSET */
+    for (i = 0; i < KEY_LENGTH - MID_OFFSET; i++) {
+        y[i] = untwist(state->key[i] ^ state->key[i + MID_OFFSET]);
+    }
+    for (i = 1; i < KEY_LENGTH - MID_OFFSET + 1; i++) {
+        state->key[i] = (y[i] & UPPER_MASK) | (y[i - 1] & LOWER_MASK);
     }
     /* set lower bits of first key entry */
-    tmp = state->key[KEY_LENGTH - 1] ^ state->key[MID_OFFSET - 1];
-    odd = (tmp & UPPER_MASK) == UPPER_MASK;
-    tmp ^= (-odd & MATRIX_A);
-    tmp = (tmp << 1) | odd;
-    state->key[0] |= tmp & LOWER_MASK;
+    state->key[0] = (y[0] & UPPER_MASK) |
+                    (untwist(state->key[KEY_LENGTH - 1] ^
+                             state->key[MID_OFFSET - 1]) & LOWER_MASK);
     state->n_twists--;
+    COUNT(state, reverse_twists);
+}
+
+/* Switches direction of state updates, moving position to last value. */
+static void flip(rng_state *state)
+{
+    if (state->reversed == 0) {
+        state->reversed = 1;
+        state->pos--;
+    }
+    else {
+        state->reversed = 0;
+        state->pos++;
+    }
 }
 
 /*
@@ -184,101 +588,1849 @@ void reverse_twist(rng_state *state)
  *
  * After calling the next random value generated will be exactly equal to the
  * last generated before call, the second equal to the penultimate and so on.
+ *
+ * A spare normal value was generated with the last normal value returned,
+ * from the four random integers preceding the current position. The spare is
+ * replaced by that last value and the state moved back past those integers,
+ * as if the pair were generated by the next normal value in the reversed
+ * direction, so the next normal value is again the last generated.
+ */
+void revrand_reverse(rng_state *state)
+{
+    double value;
+    count_words(state);
+    flip(state);
+    restart_word_count(state);
+    COUNT(state, reversals);
+    if (state->has_spare_normal != 0) {
+        value = state->spare_normals[0];
+        state->spare_normals[0] = state->spare_normals[1];
+        state->spare_normals[1] = value;
+        revrand_jump(state, 4);
+    }
+}
+
+/*
+ * Saves the current key in slot n_twists modulo capacity of the state's
+ * checkpoint cache, if any, so the cache holds the most recently visited key
+ * for each slot. Only twisted (n_twists >= 1) keys are saved, as only those
+ * are exactly recovered by reverse_twist.
+ */
+static void save_checkpoint(rng_state *state)
+{
+    rng_checkpoints *checkpoints = state->checkpoints;
+    size_t slot;
+    if (checkpoints == NULL || state->n_twists < 1) {
+        return;
+    }
+    slot = (size_t) (state->n_twists % (long long) checkpoints->capacity);
+    if (checkpoints->tags[slot] != state->n_twists) {
+        memcpy(&checkpoints->keys[slot * KEY_LENGTH], state->key,
+               KEY_LENGTH * sizeof(uint32_t));
+        checkpoints->tags[slot] = state->n_twists;
+    }
+}
+
+/*
+ * Copies key of block n_twists from the state's checkpoint cache, if any,
+ * returning non-zero if it was saved there and zero otherwise.
+ */
+static int load_checkpoint(rng_state *state, long long n_twists)
+{
+    rng_checkpoints *checkpoints = state->checkpoints;
+    size_t slot;
+    if (checkpoints == NULL || n_twists < 1) {
+        return 0;
+    }
+    slot = (size_t) (n_twists % (long long) checkpoints->capacity);
+    if (checkpoints->tags[slot] != n_twists) {
+        return 0;
+    }
+    memcpy(state->key, &checkpoints->keys[slot * KEY_LENGTH],
+           KEY_LENGTH * sizeof(uint32_t));
+    state->n_twists = n_twists;
+    COUNT(state, checkpoint_loads);
+    return 1;
+}
+
+/*
+ * Reverses twist of state as reverse_twist, copying the previous key from the
+ * state's checkpoint cache if saved there rather than recomputing it.
+ */
+static void reverse_twist_cached(rng_state *state)
+{
+    if (load_checkpoint(state, state->n_twists - 1)) {
+        return;
+    }
+    reverse_twist_block(state);
+    save_checkpoint(state);
+}
+
+/*
+ * Computes the key adjacent to the current block of state in its current
+ * direction on a copy of the key, storing it in lookahead tagged with its
+ * n_twists. Keys are only computed from and to blocks with n_twists >= 0, as
+ * keys before the initial key depend on the path taken to them, so any state
+ * of the same seed at a block next to the tag moves to the same key.
  */
-void reverse(rng_state *state)
+void revrand_prepare_block(const rng_state *state, rng_lookahead *lookahead)
 {
+    rng_state copy;
+    long long tag = state->reversed == 0 ?
+        state->n_twists + 1 : state->n_twists - 1;
+    if (lookahead->tag == tag || state->n_twists < 0 || tag < 0) {
+        return;
+    }
+    memcpy(copy.key, state->key, KEY_LENGTH * sizeof(uint32_t));
+    copy.seed = state->seed;
+    copy.n_twists = state->n_twists;
+    copy.engine = state->engine;
+    copy.counters = state->counters;
     if (state->reversed == 0) {
-        state->reversed = 1;
-        state->pos--;
+        twist_block(&copy);
     }
     else {
-        state->reversed = 0;
-        state->pos++;
+        reverse_twist_block(&copy);
     }
+    memcpy(lookahead->key, copy.key, KEY_LENGTH * sizeof(uint32_t));
+    lookahead->tag = tag;
 }
 
 /*
- * Generates a random integer uniformly from range [0, 2^32 - 1].
+ * Copies key of block n_twists next to the current block from the state's
+ * lookahead buffer, if any, returning non-zero if it held that key and zero
+ * otherwise. As for prepare_block only moves between blocks with n_twists
+ * >= 0 are loaded.
+ */
+static int load_lookahead(rng_state *state, long long n_twists)
+{
+    rng_lookahead *lookahead = state->lookahead;
+    if (lookahead == NULL || n_twists < 0 || state->n_twists < 0 ||
+            lookahead->tag != n_twists) {
+        return 0;
+    }
+    memcpy(state->key, lookahead->key, KEY_LENGTH * sizeof(uint32_t));
+    state->n_twists = n_twists;
+    COUNT(state, lookahead_loads);
+    return 1;
+}
+
+/*
+ * Moves to start of next key block, twisting state. Called by the inline
+ * generator functions in revrand.h when the key is exhausted.
+ */
+void revrand_next_block(rng_state *state)
+{
+    save_checkpoint(state);
+    if (!load_lookahead(state, state->n_twists + 1)) {
+        twist_block(state);
+    }
+    state->pos = 0;
+}
+
+/*
+ * Moves to end of previous key block, reverse-twisting state. Called by the
+ * inline generator functions in revrand.h when the key is exhausted in the
+ * reverse direction.
+ */
+void revrand_prev_block(rng_state *state)
+{
+    if (load_lookahead(state, state->n_twists - 1)) {
+        save_checkpoint(state);
+    }
+    else {
+        reverse_twist_cached(state);
+    }
+    state->pos = KEY_LENGTH - 1;
+    /* Philox keys depend only on their index so need no correction */
+    if (state->engine == REVRAND_ENGINE_PHILOX) {
+        return;
+    }
+    /*
+     * reverse_twist will not correctly recover initial key value as
+     * seed when rolling back first twist therefore manually set
+     */
+    if (state->n_twists == 0) {
+        state->key[0] = state->seed;
+    }
+    /*
+     * keys before the initial key depend on the path taken to them and so
+     * may differ from those saved or prepared, therefore invalidate caches
+     */
+    else if (state->n_twists == -1) {
+        if (state->checkpoints != NULL) {
+            revrand_clear_checkpoints(state->checkpoints);
+        }
+        if (state->lookahead != NULL) {
+            revrand_clear_lookahead(state->lookahead);
+        }
+    }
+}
+
+
+/*
+ * Exponents of the non-leading terms of the characteristic polynomial phi of
+ * the MT-19937 state transition, i.e. phi(x) = x^19937 + sum_i x^TERMS[i].
  *
- * This is the base Mersenne-Twister generator used by all other derived
- * random generator functions.
+ * Computed by the Berlekamp-Massey algorithm from a generated bit sequence.
+ * The sequence of states satisfies phi(T) = 0 for T the linear map advancing
+ * the state by one word and so T^d = g(T) where g(x) = x^d mod phi(x).
+ */
+static const int JUMP_POLY_TERMS[JUMP_POLY_N_TERMS] = {
+    0, 1189, 1416, 1585, 1643, 1870, 2493, 2773, 3000, 3227,
+    3454, 3681, 3908, 4135, 4362, 4753, 5661, 6337, 6569, 7129,
+    7477, 7525, 7583, 7752, 7979, 8206, 9505, 9901, 9969, 10128,
+    10693, 10761, 10920, 11089, 11147, 11157, 11215, 11321, 11374, 11384,
+    11485, 11611, 11712, 11717, 11838, 11881, 11944, 11997, 12277, 12335,
+    12393, 12504, 12509, 12620, 12673, 12731, 12736, 12789, 12905, 12958,
+    12963, 13137, 13185, 13190, 13243, 13301, 13412, 13528, 13533, 13639,
+    13697, 13760, 13813, 13866, 14093, 14151, 14209, 14320, 14325, 14436,
+    14547, 14552, 14605, 14721, 14774, 14779, 14953, 15001, 15006, 15059,
+    15117, 15228, 15344, 15349, 15455, 15513, 15576, 15629, 15682, 15909,
+    15967, 16025, 16136, 16141, 16252, 16363, 16368, 16421, 16537, 16590,
+    16595, 16817, 16822, 16875, 16933, 17044, 17160, 17271, 17329, 17445,
+    17498, 17725, 17783, 17841, 17952, 18068, 18179, 18237, 18406, 18633,
+    18691, 18860, 19087, 19314
+};
+
+/*
+ * XORs the n_words word bit string src in to dst starting at bit offset.
+ * dst must have at least n_words + 1 words from bit offset onwards unless
+ * offset is a multiple of 64.
  */
-unsigned long random_int32(rng_state *state)
+static void poly_xor_shifted(uint64_t *dst, const uint64_t *src, int n_words,
+                             int offset)
 {
-    unsigned long y;
-    /* if forward direction and at end of key, twist */
-    if (state->reversed == 0) {
-        if (state->pos == KEY_LENGTH) {
-            twist(state);
-            state->pos = 0;
+    int i, shift = offset & 63;
+    dst += offset >> 6;
+    if (shift == 0) {
+        for (i = 0; i < n_words; i++) {
+            dst[i] ^= src[i];
         }
-        y = state->key[state->pos++];
     }
-    /* if reverse direction and at beginning of key, reverse-twist */
     else {
-        if (state->pos == -1) {
-            reverse_twist(state);
-            state->pos = KEY_LENGTH - 1;
-            /*
-             * reverse_twist will not correctly recover initial key value as
-             * seed when rolling back first twist therefore manually set
-             */
-            if (state->n_twists == 0) {
-                state->key[0] = state->seed;
+        dst[0] ^= src[0] << shift;
+        for (i = 1; i < n_words; i++) {
+            dst[i] ^= (src[i] << shift) | (src[i - 1] >> (64 - shift));
+        }
+        dst[n_words] ^= src[n_words - 1] >> (64 - shift);
+    }
+}
+
+/*
+ * Reduces polynomial a of degree < 2 * JUMP_POLY_DEGREE - 1 modulo phi.
+ *
+ * As phi is sparse with its second highest term 623 lower than its leading
+ * term, the terms of a of degree >= JUMP_POLY_DEGREE are eliminated in chunks
+ * of up to 623 terms from the top down, each by XORing the chunk shifted by
+ * each of the non-leading term exponents of phi in to the lower terms.
+ */
+static void poly_reduce(uint64_t *a)
+{
+    int i, lo, hi, width, n_words, word, shift;
+    uint64_t chunk[JUMP_POLY_WORDS];
+    width = JUMP_POLY_DEGREE - JUMP_POLY_TERMS[JUMP_POLY_N_TERMS - 1];
+    for (hi = 2 * JUMP_POLY_DEGREE - 1; hi > JUMP_POLY_DEGREE; hi = lo) {
+        lo = hi - width > JUMP_POLY_DEGREE ? hi - width : JUMP_POLY_DEGREE;
+        /* extract terms [lo, hi) of a in to chunk and clear from a */
+        n_words = (hi - lo + 63) >> 6;
+        word = lo >> 6;
+        shift = lo & 63;
+        for (i = 0; i < n_words; i++) {
+            chunk[i] = a[word + i] >> shift;
+            if (shift != 0) {
+                chunk[i] |= a[word + i + 1] << (64 - shift);
             }
         }
-        y = state->key[state->pos--];
+        if (((hi - lo) & 63) != 0) {
+            chunk[n_words - 1] &= ((uint64_t) 1 << ((hi - lo) & 63)) - 1;
+        }
+        a[word] &= ((uint64_t) 1 << shift) - 1;
+        for (i = word + 1; i <= hi >> 6; i++) {
+            a[i] = 0;
+        }
+        for (i = 0; i < JUMP_POLY_N_TERMS; i++) {
+            poly_xor_shifted(a, chunk, n_words,
+                             lo - JUMP_POLY_DEGREE + JUMP_POLY_TERMS[i]);
+        }
+    }
+}
+
+/* Spreads the 32 bits of x to the even bits of a 64-bit word. */
+static uint64_t spread_bits(uint64_t x)
+{
+    x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ffULL;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x << 2)) & 0x3333333333333333ULL;
+    x = (x | (x << 1)) & 0x5555555555555555ULL;
+    return x;
+}
+
+/* Squares polynomial a modulo phi in place (squaring over GF(2) is linear). */
+static void poly_square(uint64_t *a)
+{
+    int i;
+    /* ensure space for shifted chunk words beyond product */
+    uint64_t square[2 * JUMP_POLY_WORDS + 1];
+    for (i = 0; i < JUMP_POLY_WORDS; i++) {
+        square[2 * i] = spread_bits(a[i] & 0xffffffffULL);
+        square[2 * i + 1] = spread_bits(a[i] >> 32);
+    }
+    square[2 * JUMP_POLY_WORDS] = 0;
+    poly_reduce(square);
+    memcpy(a, square, JUMP_POLY_WORDS * sizeof(uint64_t));
+}
+
+/* Flips terms of a corresponding to the non-leading terms of phi. */
+static void poly_add_terms(uint64_t *a)
+{
+    int i;
+    for (i = 0; i < JUMP_POLY_N_TERMS; i++) {
+        a[JUMP_POLY_TERMS[i] >> 6] ^= (uint64_t) 1 << (JUMP_POLY_TERMS[i] & 63);
+    }
+}
+
+/* Multiplies polynomial a by x modulo phi in place. */
+static void poly_mul_x(uint64_t *a)
+{
+    int i;
+    for (i = JUMP_POLY_WORDS - 1; i > 0; i--) {
+        a[i] = (a[i] << 1) | (a[i - 1] >> 63);
+    }
+    a[0] <<= 1;
+    if (a[JUMP_POLY_LEAD_WORD] & JUMP_POLY_LEAD_BIT) {
+        a[JUMP_POLY_LEAD_WORD] ^= JUMP_POLY_LEAD_BIT;
+        poly_add_terms(a);
     }
-    /* temper */
-    y ^= (y >> TEMPER_SHIFT_A);
-    y ^= (y << TEMPER_SHIFT_B) & TEMPER_MASK_B;
-    y ^= (y << TEMPER_SHIFT_C) & TEMPER_MASK_C;
-    y ^= (y >> TEMPER_SHIFT_D);
-    return y;
 }
 
 /*
- * Generate a random double-precision floating point value from uniform
- * distribution on [0,1).
+ * Divides polynomial a by x modulo phi in place. As phi has a constant term,
+ * phi is first added to a if a has a constant term, so that x divides a.
  */
-double random_uniform(rng_state *state)
+static void poly_div_x(uint64_t *a)
 {
-    long a, b;
-    if (state->reversed == 0) {
-        a = random_int32(state) >> RAND_DBL_SHIFT_A;
-        b = random_int32(state) >> RAND_DBL_SHIFT_B;
+    int i;
+    if (a[0] & 1) {
+        a[JUMP_POLY_LEAD_WORD] ^= JUMP_POLY_LEAD_BIT;
+        poly_add_terms(a);
     }
-    /* swap draw order in reverse direction */
-    else {
-        b = random_int32(state) >> RAND_DBL_SHIFT_B;
-        a = random_int32(state) >> RAND_DBL_SHIFT_A;
+    for (i = 0; i < JUMP_POLY_WORDS - 1; i++) {
+        a[i] = (a[i] >> 1) | (a[i + 1] << 63);
     }
-    return (a * RAND_DBL_MUL + b) / RAND_DBL_DIV;
+    a[JUMP_POLY_WORDS - 1] >>= 1;
 }
 
 /*
- * Generate a pair of independent random double-precision floating point
- * values from the (zero-mean, unit variance) standard normal distribution.
- *
- * Unlike Random Kit this uses the original non-polar variant of the Box-Muller
- * transform which requires evaluation of the trigonometric sin/cos functions
- * and is generally slower than the polar-method. The polar-method however
- * includes a rejection sampling step which is non-trivial to make reversible.
- * Also unlike Random Kit in the interests of reversibility there is no
- * caching of one of the values in the state hence a pair are returned by
- * writing to the two provided memory locations.
+ * Computes g(x) = x^d mod phi(x) for signed d by left-to-right binary
+ * exponentiation. For d > 0 the exponentiation is started from the largest
+ * monomial x^e with e a leading bit prefix of d and e < JUMP_POLY_DEGREE.
  */
-void random_normal_pair(rng_state *state, double *ret_1, double *ret_2)
+static void jump_polynomial(long long d, uint64_t *g)
 {
-    double r, theta;
-    if (state->reversed == 0){
-        r = sqrt(-2. * log(random_uniform(state)));
-        theta = 2. * PI * random_uniform(state);
+    int bit;
+    unsigned long long e, abs_d = (unsigned long long) d;
+    if (d < 0) {
+        abs_d = -abs_d;
     }
-    else {
-        theta = 2. * PI * random_uniform(state);
-        r = sqrt(-2. * log(random_uniform(state)));
+    memset(g, 0, JUMP_POLY_WORDS * sizeof(uint64_t));
+    bit = 63;
+    while (bit >= 0 && ((abs_d >> bit) & 1) == 0) {
+        bit--;
+    }
+    e = 0;
+    if (d > 0) {
+        while (bit >= 0 &&
+               ((e << 1) | ((abs_d >> bit) & 1)) < JUMP_POLY_DEGREE) {
+            e = (e << 1) | ((abs_d >> bit) & 1);
+            bit--;
+        }
+    }
+    g[e >> 6] = (uint64_t) 1 << (e & 63);
+    for (; bit >= 0; bit--) {
+        poly_square(g);
+        if ((abs_d >> bit) & 1) {
+            if (d > 0) {
+                poly_mul_x(g);
+            }
+            else {
+                poly_div_x(g);
+            }
+        }
+    }
+}
+
+/*
+ * Advances a circular buffer window of key values starting at index pos by one
+ * word using the twist recurrence, returning the new window start index.
+ */
+static int jump_step(uint32_t *window, int pos)
+{
+    int next = pos + 1 < KEY_LENGTH ? pos + 1 : 0;
+    int mid = pos + MID_OFFSET < KEY_LENGTH ?
+        pos + MID_OFFSET : pos + MID_OFFSET - KEY_LENGTH;
+    uint32_t y = (window[pos] & UPPER_MASK) | (window[next] & LOWER_MASK);
+    window[pos] = window[mid] ^ (y >> 1) ^ (-(y & 1) & MATRIX_A);
+    return next;
+}
+
+/*
+ * Replaces key with g(T) applied to key, viewing key as the state formed by
+ * the upper bit of key[0] and key[1] to key[KEY_LENGTH - 1], evaluating
+ * g(T) key with Horner's rule. The result is then advanced by one further word
+ * so all bits of the first output key value are determined by the state.
+ */
+REVRAND_DISPATCH
+static void apply_jump_polynomial(const uint64_t *g, uint32_t *key)
+{
+    int i, j, pos = 0, degree;
+    uint32_t acc[KEY_LENGTH], init[KEY_LENGTH];
+    memcpy(init, key, sizeof(init));
+    memset(acc, 0, sizeof(acc));
+    degree = JUMP_POLY_DEGREE - 1;
+    while (degree > 0 && ((g[degree >> 6] >> (degree & 63)) & 1) == 0) {
+        degree--;
+    }
+    for (i = degree; i >= 0; i--) {
+        pos = jump_step(acc, pos);
+        if ((g[i >> 6] >> (i & 63)) & 1) {
+            for (j = 0; j < KEY_LENGTH - pos; j++) {
+                acc[pos + j] ^= init[j];
+            }
+            for (; j < KEY_LENGTH; j++) {
+                acc[pos + j - KEY_LENGTH] ^= init[j];
+            }
+        }
     }
-    *ret_1 = r * cos(theta);
-    *ret_2 = r * sin(theta);
+    pos = jump_step(acc, pos);
+    for (i = 0; i < KEY_LENGTH; i++) {
+        key[i] = acc[(pos + i) % KEY_LENGTH];
+    }
+}
+
+/*
+ * Moves key by n_twists twists (forward if positive, backward if negative) as
+ * repeated calls to twist / reverse_twist would. For backward moves the
+ * current key must not be the initial (n_twists == 0) key. Moves of less than
+ * JUMP_MIN_TWISTS twists are done directly as being quicker.
+ *
+ * Key blocks are viewed as windows on to a word sequence satisfying the twist
+ * recurrence, with the key after n_twists twists d = n_twists * KEY_LENGTH - 1
+ * words on from the state formed by the current key less its first entry.
+ */
+static void twist_by(rng_state *state, long long n_twists)
+{
+    uint64_t g[JUMP_POLY_WORDS];
+    long long i;
+    if (n_twists > -JUMP_MIN_TWISTS && n_twists < JUMP_MIN_TWISTS) {
+        for (i = 0; i < n_twists; i++) {
+            revrand_twist(state);
+        }
+        for (i = 0; i > n_twists; i--) {
+            reverse_twist_cached(state);
+        }
+        return;
+    }
+    jump_polynomial(n_twists * KEY_LENGTH - 1, g);
+    apply_jump_polynomial(g, state->key);
+    state->n_twists += n_twists;
+    COUNT(state, jumps);
+}
+
+/*
+ * Moves key to that after n_twists twists as calling next_block / prev_block
+ * repeatedly would.
+ *
+ * The initial (n_twists == 0) key is not itself produced by a twist and so
+ * prev_block from the first twisted key resets its first entry to the seed.
+ * Backward moves therefore step through n_twists == 1 to n_twists == -1 with
+ * prev_block with only the moves either side computed by twist_by.
+ */
+static void move_to_block(rng_state *state, long long n_twists)
+{
+    if (state->engine == REVRAND_ENGINE_PHILOX) {
+        if (n_twists != state->n_twists) {
+            philox_block(state, n_twists);
+            COUNT(state, jumps);
+        }
+        return;
+    }
+    if (n_twists > state->n_twists) {
+        twist_by(state, n_twists - state->n_twists);
+    }
+    while (n_twists < state->n_twists) {
+        if (state->n_twists == 0 || state->n_twists == 1) {
+            revrand_prev_block(state);
+        }
+        else if (state->n_twists > 1 && n_twists < 1) {
+            twist_by(state, 1 - state->n_twists);
+        }
+        else {
+            twist_by(state, n_twists - state->n_twists);
+        }
+    }
+}
+
+/* Floor of integer division a / b for b > 0. */
+static long long floor_div(long long a, long long b)
+{
+    return a >= 0 ? a / b : -((-a - 1) / b) - 1;
+}
+
+/* Moves state on by n >= 0 random integers in the current direction. */
+static void skip(rng_state *state, long long n)
+{
+    long long index, n_twists;
+    if (n == 0) {
+        return;
+    }
+    /* stream index of next key value and key block of last skipped value */
+    if (state->reversed == 0) {
+        index = KEY_LENGTH * (state->n_twists - 1) + state->pos + n;
+        n_twists = floor_div(index - 1, KEY_LENGTH) + 1;
+    }
+    else {
+        index = KEY_LENGTH * (state->n_twists - 1) + state->pos - n;
+        n_twists = floor_div(index + 1, KEY_LENGTH) + 1;
+    }
+    move_to_block(state, n_twists);
+    state->pos = (int) (index - KEY_LENGTH * (n_twists - 1));
+}
+
+/*
+ * Jumps state by n random integers.
+ *
+ * For n >= 0 equivalent to n calls to random_int32 (in either direction) with
+ * the generated values discarded. For n < 0 equivalent to calling reverse,
+ * jumping by -n and calling reverse again, i.e. rewinding n previous values.
+ * Rather than generating the skipped values, the state is moved with a
+ * polynomial jump in O(log |n|) operations. Skipped values are not counted
+ * as drawn by the state counters.
+ */
+void revrand_jump(rng_state *state, long long n)
+{
+    count_words(state);
+    if (n < 0) {
+        flip(state);
+        skip(state, -n);
+        flip(state);
+    }
+    else {
+        skip(state, n);
+    }
+    restart_word_count(state);
+}
+
+/*
+ * Moves state to position index >= 0 of the stream of random integers
+ * generated forward from its seed, so that the next value generated in the
+ * forward direction is value index. The key block is copied from the
+ * checkpoint cache if saved there, otherwise moved to by jumping and then
+ * saved, so that the blocks most recently moved to are cached.
+ */
+static void seek(rng_state *state, long long index)
+{
+    long long n_twists = index / KEY_LENGTH + 1;
+    if (state->n_twists != n_twists && !load_checkpoint(state, n_twists)) {
+        move_to_block(state, n_twists);
+        save_checkpoint(state);
+    }
+    state->pos = (int) (index - KEY_LENGTH * (n_twists - 1));
+}
+
+/*
+ * Generates values k0 to k1 - 1 of the stream of random integers generated
+ * forward from the seed of state in to values[0] to values[k1 - k0 - 1].
+ *
+ * State is used as a cursor: it is moved to value k0 by jumping from its
+ * current position, or loaded from its checkpoint cache, and left as if the
+ * values had just been generated in its current direction, i.e. next
+ * generating value k1 if forward or value k0 - 1 if reversed.
+ */
+void revrand_fill_range(rng_state *state, long long k0, long long k1,
+                        uint32_t *values)
+{
+    int reversed = state->reversed;
+    count_words(state);
+    state->reversed = 0;
+    seek(state, k0);
+    restart_word_count(state);
+    revrand_random_uint32_array(state, values, (size_t) (k1 - k0));
+    if (reversed != 0) {
+        count_words(state);
+        seek(state, k0);
+        flip(state);
+        restart_word_count(state);
+    }
+}
+
+/* Returns value k of the stream of state's seed, as fill_range(k, k + 1). */
+uint32_t revrand_value_at(rng_state *state, long long k)
+{
+    uint32_t value;
+    revrand_fill_range(state, k, k + 1, &value);
+    return value;
+}
+
+/*
+ * Initialises n_streams states from an integer seed for use as independent
+ * streams, with states[i] equal to the state initialised by init_state after
+ * i * stream_twists twists (i.e. i * stream_twists * KEY_LENGTH calls to
+ * random_int32). Streams therefore do not overlap for the first
+ * stream_twists * KEY_LENGTH random integers generated forward from each.
+ *
+ * stream_twists must be positive. The jump polynomial is computed once and
+ * applied to each state in turn.
+ */
+void revrand_init_streams(unsigned long seed, rng_state *states,
+                          size_t n_streams,
+                          long long stream_twists)
+{
+    size_t i;
+    uint64_t g[JUMP_POLY_WORDS];
+    if (n_streams == 0) {
+        return;
+    }
+    revrand_init_state(seed, &states[0]);
+    if (stream_twists >= JUMP_MIN_TWISTS) {
+        jump_polynomial(stream_twists * KEY_LENGTH - 1, g);
+    }
+    for (i = 1; i < n_streams; i++) {
+        states[i] = states[i - 1];
+        if (stream_twists >= JUMP_MIN_TWISTS) {
+            apply_jump_polynomial(g, states[i].key);
+            states[i].n_twists += stream_twists;
+        }
+        else {
+            twist_by(&states[i], stream_twists);
+        }
+        revrand_reset_counters(&states[i]);
+    }
+}
+
+/* Tempers a contiguous run of n key values in to values array. */
+REVRAND_DISPATCH
+static void temper_run(const uint32_t *key, unsigned long *values,
+                       size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++) {
+        values[i] = revrand_temper(key[i]);
+    }
+}
+
+/*
+ * Fills an array with n random integers uniformly from range [0, 2^32 - 1].
+ *
+ * Equivalent to n calls to random_int32 with the values written to increasing
+ * array indices in the forward direction and decreasing indices in the
+ * reverse direction, such that a reversed call exactly regenerates the array
+ * of a preceding forward call. Rather than checking the key position per
+ * value, the key is consumed in whole runs between twists.
+ */
+void revrand_random_int32_array(rng_state *state, unsigned long *values,
+                                size_t n)
+{
+    size_t done = 0, run;
+    if (state->reversed == 0) {
+        while (done < n) {
+            if (state->pos == KEY_LENGTH) {
+                revrand_next_block(state);
+            }
+            run = KEY_LENGTH - state->pos;
+            if (run > n - done) {
+                run = n - done;
+            }
+            temper_run(&state->key[state->pos], &values[done], run);
+            state->pos += run;
+            done += run;
+        }
+    }
+    /*
+     * in reverse direction a run of key values read in decreasing order is
+     * written to decreasing array indices, so the run is copied in order
+     */
+    else {
+        while (done < n) {
+            if (state->pos == -1) {
+                revrand_prev_block(state);
+            }
+            run = state->pos + 1;
+            if (run > n - done) {
+                run = n - done;
+            }
+            temper_run(&state->key[state->pos + 1 - run],
+                       &values[n - done - run], run);
+            state->pos -= run;
+            done += run;
+        }
+    }
+}
+
+/* Tempers a contiguous run of n key values in to uint32 values array. */
+REVRAND_DISPATCH
+static void temper_uint32_run(const uint32_t *key, uint32_t *values,
+                              size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++) {
+        values[i] = revrand_temper(key[i]);
+    }
+}
+
+/*
+ * Fills an array with n random 32-bit unsigned integers.
+ *
+ * As random_int32_array but with values packed in to uint32_t entries.
+ */
+void revrand_random_uint32_array(rng_state *state, uint32_t *values, size_t n)
+{
+    size_t done = 0, run;
+    if (state->reversed == 0) {
+        while (done < n) {
+            if (state->pos == KEY_LENGTH) {
+                revrand_next_block(state);
+            }
+            run = KEY_LENGTH - state->pos;
+            if (run > n - done) {
+                run = n - done;
+            }
+            temper_uint32_run(&state->key[state->pos], &values[done], run);
+            state->pos += run;
+            done += run;
+        }
+    }
+    else {
+        while (done < n) {
+            if (state->pos == -1) {
+                revrand_prev_block(state);
+            }
+            run = state->pos + 1;
+            if (run > n - done) {
+                run = n - done;
+            }
+            temper_uint32_run(&state->key[state->pos + 1 - run],
+                              &values[n - done - run], run);
+            state->pos -= run;
+            done += run;
+        }
+    }
+}
+
+/*
+ * Tempers a contiguous run of 2 * n key values and packs consecutive pairs
+ * in to n 64-bit values as in random_int64.
+ */
+REVRAND_DISPATCH
+static void temper_int64_run(const uint32_t *key, uint64_t *values, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++) {
+        values[i] = ((uint64_t) revrand_temper(key[2 * i]) << 32) |
+                    revrand_temper(key[2 * i + 1]);
+    }
+}
+
+/*
+ * Fills an array with n random integers uniformly from range [0, 2^64 - 1].
+ *
+ * Equivalent to n calls to random_int64 with the same array ordering
+ * semantics as random_int32_array, consuming the key in runs of pairs as in
+ * random_uniform_array.
+ */
+void revrand_random_int64_array(rng_state *state, uint64_t *values, size_t n)
+{
+    size_t done = 0, run;
+    if (state->reversed == 0) {
+        while (done < n) {
+            if (state->pos == KEY_LENGTH) {
+                revrand_next_block(state);
+            }
+            if (state->pos == KEY_LENGTH - 1) {
+                values[done++] = revrand_random_int64(state);
+                continue;
+            }
+            run = (KEY_LENGTH - state->pos) / 2;
+            if (run > n - done) {
+                run = n - done;
+            }
+            temper_int64_run(&state->key[state->pos], &values[done], run);
+            state->pos += 2 * run;
+            done += run;
+        }
+    }
+    else {
+        while (done < n) {
+            if (state->pos == -1) {
+                revrand_prev_block(state);
+            }
+            if (state->pos == 0) {
+                values[n - 1 - done++] = revrand_random_int64(state);
+                continue;
+            }
+            run = (state->pos + 1) / 2;
+            if (run > n - done) {
+                run = n - done;
+            }
+            temper_int64_run(&state->key[state->pos + 1 - 2 * run],
+                             &values[n - done - run], run);
+            state->pos -= 2 * run;
+            done += run;
+        }
+    }
+}
+
+/* Maps a 64-bit random integer x to [0, bound) as floor(x * bound / 2^64). */
+static uint32_t bounded(uint64_t x, uint64_t bound)
+{
+    /* exact high word of 96-bit product as bound <= 2^32 */
+    return (uint32_t) (((x >> 32) * bound +
+                        (((x & 0xffffffffULL) * bound) >> 32)) >> 32);
+}
+
+/*
+ * Tempers a contiguous run of 2 * n key values and maps consecutive pairs to
+ * n bounded integers as in random_bounded.
+ */
+REVRAND_DISPATCH
+static void temper_bounded_run(const uint32_t *key, uint64_t bound,
+                               uint32_t *values, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++) {
+        values[i] = bounded(((uint64_t) revrand_temper(key[2 * i]) << 32) |
+                            revrand_temper(key[2 * i + 1]), bound);
+    }
+}
+
+/*
+ * Generates a random integer from range [0, bound - 1] for 1 <= bound <= 2^32.
+ *
+ * Uses the multiply-shift reduction of a 64-bit random integer from
+ * random_int64. Rejection of the biased products is not performed, as it
+ * would make the number of random integers consumed depend on their values
+ * and so not be reversible, but with 64 bits the relative bias of any
+ * value's probability is below bound / 2^64 <= 2^-32.
+ */
+uint32_t revrand_random_bounded(rng_state *state, uint64_t bound)
+{
+    return bounded(revrand_random_int64(state), bound);
+}
+
+/*
+ * Fills an array with n random integers from range [0, bound - 1].
+ *
+ * Equivalent to n calls to random_bounded with the same array ordering
+ * semantics and run structure as random_int64_array.
+ */
+void revrand_random_bounded_array(rng_state *state, uint64_t bound,
+                                  uint32_t *values,
+                                  size_t n)
+{
+    size_t done = 0, run;
+    if (state->reversed == 0) {
+        while (done < n) {
+            if (state->pos == KEY_LENGTH) {
+                revrand_next_block(state);
+            }
+            if (state->pos == KEY_LENGTH - 1) {
+                values[done++] = revrand_random_bounded(state, bound);
+                continue;
+            }
+            run = (KEY_LENGTH - state->pos) / 2;
+            if (run > n - done) {
+                run = n - done;
+            }
+            temper_bounded_run(&state->key[state->pos], bound, &values[done],
+                               run);
+            state->pos += 2 * run;
+            done += run;
+        }
+    }
+    else {
+        while (done < n) {
+            if (state->pos == -1) {
+                revrand_prev_block(state);
+            }
+            if (state->pos == 0) {
+                values[n - 1 - done++] = revrand_random_bounded(state, bound);
+                continue;
+            }
+            run = (state->pos + 1) / 2;
+            if (run > n - done) {
+                run = n - done;
+            }
+            temper_bounded_run(&state->key[state->pos + 1 - 2 * run], bound,
+                               &values[n - done - run], run);
+            state->pos -= 2 * run;
+            done += run;
+        }
+    }
+}
+
+/*
+ * Number of random integers consumed per Bernoulli mask for probability p,
+ * exported so that callers splitting or skipping mask draws use the same
+ * count.
+ */
+int revrand_bernoulli_words(uint64_t p)
+{
+    int k = 32;
+    if (p == 0 || p >= BOUND_MAX) {
+        return 0;
+    }
+    while ((p & 1) == 0) {
+        p >>= 1;
+        k--;
+    }
+    return k;
+}
+
+/*
+ * Computes n Bernoulli masks from n consecutive runs of k random integers.
+ *
+ * Bit j of each mask is set if the k-bit binary fraction formed from bit j of
+ * the run's integers, most significant first, is less than p / 2^32, whose
+ * binary expansion terminates after k bits. The comparison is evaluated for
+ * all 32 bits at once, tracking which are already less than and still equal
+ * to the prefix of p.
+ */
+REVRAND_DISPATCH
+static void bernoulli_run(const uint32_t *words, uint64_t p, int k,
+                          uint32_t *masks, size_t n)
+{
+    size_t i;
+    int b;
+    uint32_t less, equal, w, p_bit;
+    for (i = 0; i < n; i++) {
+        less = 0;
+        equal = 0xffffffffUL;
+        for (b = 0; b < k; b++) {
+            w = words[i * k + b];
+            p_bit = ((p >> (31 - b)) & 1) ? 0xffffffffUL : 0;
+            less |= equal & ~w & p_bit;
+            equal &= ~(w ^ p_bit);
+        }
+        masks[i] = less;
+    }
+}
+
+/*
+ * Fills an array with n masks of 32 independent Bernoulli variables.
+ *
+ * Each bit of each mask is set with probability p / 2^32 for 0 <= p <= 2^32.
+ * Each mask consumes the same number k <= 32 of random integers, equal to
+ * the number of significant bits in the binary fraction p / 2^32 (so a
+ * single integer for p = 2^31 and none for p = 0 or p = 2^32), so masks have
+ * the same array ordering semantics as random_int32_array.
+ */
+void revrand_random_bernoulli_masks(rng_state *state, uint64_t p,
+                                    uint32_t *masks,
+                                    size_t n)
+{
+    uint32_t words[BERNOULLI_CHUNK * 32];
+    size_t i, start, n_chunks, size;
+    int k = revrand_bernoulli_words(p);
+    if (k == 0) {
+        for (i = 0; i < n; i++) {
+            masks[i] = p == 0 ? 0 : 0xffffffffUL;
+        }
+        return;
+    }
+    /*
+     * masks are generated in fixed chunks, with the chunks visited in
+     * decreasing order in the reverse direction - as random_uint32_array
+     * regenerates the words of each chunk in their forward order, each chunk
+     * then reproduces the masks of the corresponding forward chunk
+     */
+    n_chunks = (n + BERNOULLI_CHUNK - 1) / BERNOULLI_CHUNK;
+    for (i = 0; i < n_chunks; i++) {
+        start = (state->reversed == 0 ? i : n_chunks - 1 - i) *
+                BERNOULLI_CHUNK;
+        size = n - start < BERNOULLI_CHUNK ? n - start : BERNOULLI_CHUNK;
+        revrand_random_uint32_array(state, words, size * k);
+        bernoulli_run(words, p, k, &masks[start], size);
+    }
+}
+
+/*
+ * Tempers a contiguous run of 2 * n key values and combines consecutive pairs
+ * in to n doubles on [0,1) as in random_uniform.
+ *
+ * The shifted values fit in 27 bits so are cast to signed integers before
+ * conversion to allow use of signed integer to double vector conversions.
+ */
+REVRAND_DISPATCH
+static void temper_uniform_run(const uint32_t *key, double *values, size_t n)
+{
+    size_t i;
+    int32_t a, b;
+    for (i = 0; i < n; i++) {
+        a = (int32_t) (revrand_temper(key[2 * i]) >> RAND_DBL_SHIFT_A);
+        b = (int32_t) (revrand_temper(key[2 * i + 1]) >> RAND_DBL_SHIFT_B);
+        values[i] = (a * RAND_DBL_MUL + b) / RAND_DBL_DIV;
+    }
+}
+
+/*
+ * Fills an array with n random double-precision floating point values from
+ * uniform distribution on [0,1).
+ *
+ * Equivalent to n calls to random_uniform with the same array ordering
+ * semantics as random_int32_array. Runs of values are generated directly from
+ * pairs of key values between twists, with only a value whose pair of key
+ * values straddles a twist generated by a call to random_uniform. As in
+ * random_int32_array a run in the reverse direction is read from the key in
+ * increasing order, so the swapped draw order of random_uniform is matched
+ * without reordering the key values.
+ */
+void revrand_random_uniform_array(rng_state *state, double *values, size_t n)
+{
+    size_t done = 0, run;
+    if (state->reversed == 0) {
+        while (done < n) {
+            if (state->pos == KEY_LENGTH) {
+                revrand_next_block(state);
+            }
+            if (state->pos == KEY_LENGTH - 1) {
+                values[done++] = revrand_random_uniform(state);
+                continue;
+            }
+            run = (KEY_LENGTH - state->pos) / 2;
+            if (run > n - done) {
+                run = n - done;
+            }
+            temper_uniform_run(&state->key[state->pos], &values[done], run);
+            state->pos += 2 * run;
+            done += run;
+        }
+    }
+    else {
+        while (done < n) {
+            if (state->pos == -1) {
+                revrand_prev_block(state);
+            }
+            if (state->pos == 0) {
+                values[n - 1 - done++] = revrand_random_uniform(state);
+                continue;
+            }
+            run = (state->pos + 1) / 2;
+            if (run > n - done) {
+                run = n - done;
+            }
+            temper_uniform_run(&state->key[state->pos + 1 - 2 * run],
+                               &values[n - done - run], run);
+            state->pos -= 2 * run;
+            done += run;
+        }
+    }
+}
+
+/*
+ * Tempers a contiguous run of n key values in to n floats on [0, 1) as in
+ * random_uniform_float.
+ */
+REVRAND_DISPATCH
+static void temper_float_run(const uint32_t *key, float *values, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++) {
+        values[i] = (int32_t) (revrand_temper(key[i]) >> RAND_FLT_SHIFT) /
+                    RAND_FLT_DIV;
+    }
+}
+
+/*
+ * Fills an array with n random single-precision floating point values from
+ * uniform distribution on [0,1).
+ *
+ * Equivalent to n calls to random_uniform_float with the same array ordering
+ * semantics as random_int32_array and consuming the key in runs as there.
+ */
+void revrand_random_uniform_float_array(rng_state *state, float *values,
+                                        size_t n)
+{
+    size_t done = 0, run;
+    if (state->reversed == 0) {
+        while (done < n) {
+            if (state->pos == KEY_LENGTH) {
+                revrand_next_block(state);
+            }
+            run = KEY_LENGTH - state->pos;
+            if (run > n - done) {
+                run = n - done;
+            }
+            temper_float_run(&state->key[state->pos], &values[done], run);
+            state->pos += run;
+            done += run;
+        }
+    }
+    else {
+        while (done < n) {
+            if (state->pos == -1) {
+                revrand_prev_block(state);
+            }
+            run = state->pos + 1;
+            if (run > n - done) {
+                run = n - done;
+            }
+            temper_float_run(&state->key[state->pos + 1 - run],
+                             &values[n - done - run], run);
+            state->pos -= run;
+            done += run;
+        }
+    }
+}
+
+/*
+ * Wichura (1988) AS241 normal inverse CDF rational approximation coefficients
+ * (numerator and denominator coefficients in increasing powers) for the
+ * central region (A, B), intermediate tails (C, D) and far tails (E, F).
+ */
+static const double ICDF_A[8] = {
+    3.3871328727963666080e0, 1.3314166789178437745e+2,
+    1.9715909503065514427e+3, 1.3731693765509461125e+4,
+    4.5921953931549871457e+4, 6.7265770927008700853e+4,
+    3.3430575583588128105e+4, 2.5090809287301226727e+3
+};
+static const double ICDF_B[8] = {
+    1., 4.2313330701600911252e+1,
+    6.8718700749205790830e+2, 5.3941960214247511077e+3,
+    2.1213794301586595867e+4, 3.9307895800092710610e+4,
+    2.8729085735721942674e+4, 5.2264952788528545610e+3
+};
+static const double ICDF_C[8] = {
+    1.42343711074968357734e0, 4.63033784615654529590e0,
+    5.76949722146069140550e0, 3.64784832476320460504e0,
+    1.27045825245236838258e0, 2.41780725177450611770e-1,
+    2.27238449892691845833e-2, 7.74545014278341407640e-4
+};
+static const double ICDF_D[8] = {
+    1., 2.05319162663775882187e0,
+    1.67638483018380384940e0, 6.89767334985100004550e-1,
+    1.48103976427480074590e-1, 1.51986665636164571966e-2,
+    5.47593808499534494600e-4, 1.05075007164441684324e-9
+};
+static const double ICDF_E[8] = {
+    6.65790464350110377720e0, 5.46378491116411436990e0,
+    1.78482653991729133580e0, 2.96560571828504891230e-1,
+    2.65321895265761230930e-2, 1.24266094738807843860e-3,
+    2.71155556874348757815e-5, 2.01033439929228813265e-7
+};
+static const double ICDF_F[8] = {
+    1., 5.99832206555887937690e-1,
+    1.36929880922735805310e-1, 1.48753612908506148525e-2,
+    7.86869131145613259100e-4, 1.84631831751005468180e-5,
+    1.42151175831644588870e-7, 2.04426310338993978564e-15
+};
+
+/*
+ * Natural logarithm of a double-precision floating point value in [0, 1).
+ *
+ * Branch-free (and so vectorizable) form of the fdlibm log algorithm for
+ * finite positive normal values, which includes all non-zero outputs of
+ * random_uniform, with an error of less than 1 ulp. Zero maps to -infinity.
+ */
+static inline double log_unit(double x)
+{
+    uint64_t bits;
+    uint32_t high;
+    int k;
+    double f, hfsq, s, z, w, r;
+    memcpy(&bits, &x, sizeof(bits));
+    /* reduce x to 2^k * (1 + f) with 1 + f in [sqrt(2) / 2, sqrt(2)) */
+    high = (uint32_t) (bits >> 32) + (0x3ff00000 - 0x3fe6a09e);
+    k = (int) (high >> 20) - 0x3ff;
+    high = (high & 0x000fffff) + 0x3fe6a09e;
+    bits = ((uint64_t) high << 32) | (bits & 0xffffffff);
+    memcpy(&f, &bits, sizeof(f));
+    f -= 1.;
+    hfsq = 0.5 * f * f;
+    s = f / (2. + f);
+    z = s * s;
+    w = z * z;
+    r = z * (LOG_LG1 + w * (LOG_LG3 + w * (LOG_LG5 + w * LOG_LG7))) +
+        w * (LOG_LG2 + w * (LOG_LG4 + w * LOG_LG6));
+    r = s * (hfsq + r) + k * LOG_LN2_LO - hfsq + f + k * LOG_LN2_HI;
+    return x == 0. ? -HUGE_VAL : r;
+}
+
+/*
+ * Evaluates sin(2 * pi * u) and cos(2 * pi * u) for u in [0, 1).
+ *
+ * The angle is reduced exactly in quarter turns as 4 * u = n + d for integer n
+ * and |d| <= 1/2, so unlike evaluating sin(2 * pi * u) with libm there is no
+ * rounding of the angle. sin(pi * d / 2) and cos(pi * d / 2) are evaluated by
+ * polynomials and then swapped and negated as required by the quadrant n.
+ * Branch-free (and so vectorizable), with errors of less than 2 ulp.
+ */
+static inline void sincos_2pi(double u, double *sin_ret, double *cos_ret)
+{
+    int32_t n = (int32_t) (4. * u + 0.5);
+    double d = 4. * u - n, z = d * d, sin_d, cos_d, sin_q, cos_q;
+    sin_d = d * (SIN_C0 + z * (SIN_C1 + z * (SIN_C2 + z * (SIN_C3 + z *
+            (SIN_C4 + z * (SIN_C5 + z * (SIN_C6 + z * (SIN_C7 + z *
+            SIN_C8))))))));
+    cos_d = 1. + z * (COS_C1 + z * (COS_C2 + z * (COS_C3 + z * (COS_C4 + z *
+            (COS_C5 + z * (COS_C6 + z * (COS_C7 + z * COS_C8)))))));
+    sin_q = n & 1 ? cos_d : sin_d;
+    cos_q = n & 1 ? sin_d : cos_d;
+    *sin_ret = n & 2 ? -sin_q : sin_q;
+    *cos_ret = (n + 1) & 2 ? -cos_q : cos_q;
+}
+
+/*
+ * Box-Muller transform of a pair of uniform values on [0, 1) in to a pair of
+ * independent standard normal values, with the radius computed from u_r and
+ * the angle from u_theta.
+ *
+ * Results are within 4 ulp of the exact transform of the uniform values. As
+ * only basic IEEE arithmetic is used the results do not depend on the
+ * platform libm, provided the compiler does not contract multiply-adds (which
+ * setup.py disables).
+ */
+static inline void box_muller(double u_r, double u_theta,
+                              double *ret_1, double *ret_2)
+{
+    double r = sqrt(-2. * log_unit(u_r)), sin_theta, cos_theta;
+    sincos_2pi(u_theta, &sin_theta, &cos_theta);
+    *ret_1 = r * cos_theta;
+    *ret_2 = r * sin_theta;
+}
+
+/*
+ * Box-Muller transforms n pairs of uniform values in place, with each pair
+ * (u_r, u_theta) replaced by the corresponding pair of normal values.
+ */
+REVRAND_DISPATCH
+static void box_muller_run(double *values, size_t n)
+{
+    size_t i;
+    double u_r, u_theta;
+    for (i = 0; i < n; i++) {
+        u_r = values[2 * i];
+        u_theta = values[2 * i + 1];
+        box_muller(u_r, u_theta, &values[2 * i], &values[2 * i + 1]);
+    }
+}
+
+/*
+ * Generate a pair of independent random double-precision floating point
+ * values from the (zero-mean, unit variance) standard normal distribution.
+ *
+ * Unlike Random Kit this uses the original non-polar variant of the Box-Muller
+ * transform which requires evaluation of the trigonometric sin/cos functions
+ * and is generally slower than the polar-method. The polar-method however
+ * includes a rejection sampling step which is non-trivial to make reversible.
+ * Also unlike Random Kit in the interests of reversibility there is no
+ * caching of one of the values in the state hence a pair are returned by
+ * writing to the two provided memory locations. The same transform kernel is
+ * used as in random_normal_array so scalar and array draws agree exactly.
+ */
+void revrand_random_normal_pair(rng_state *state, double *ret_1, double *ret_2)
+{
+    double u_r, u_theta;
+    if (state->reversed == 0){
+        u_r = revrand_random_uniform(state);
+        u_theta = revrand_random_uniform(state);
+    }
+    else {
+        u_theta = revrand_random_uniform(state);
+        u_r = revrand_random_uniform(state);
+    }
+    box_muller(u_r, u_theta, ret_1, ret_2);
+}
+
+/*
+ * Fills values with n random standard normal values generated in pairs, as
+ * described for random_normal_array with, if n is odd, the last entry set to
+ * the first value of a further pair with the second value discarded.
+ */
+static void normal_pairs_array(rng_state *state, double *values, size_t n)
+{
+    size_t n_pairs = n / 2, start, n_block, i;
+    double discarded;
+    /* in reverse direction any odd entry was generated last so comes first */
+    if (state->reversed != 0 && n & 1) {
+        revrand_random_normal_pair(state, &values[n - 1], &discarded);
+    }
+    for (i = 0; i < n_pairs; i += n_block) {
+        n_block = n_pairs - i < KEY_LENGTH / 2 ? n_pairs - i : KEY_LENGTH / 2;
+        start = state->reversed == 0 ? i : n_pairs - i - n_block;
+        revrand_random_uniform_array(state, &values[2 * start], 2 * n_block);
+        box_muller_run(&values[2 * start], n_block);
+    }
+    if (state->reversed == 0 && n & 1) {
+        revrand_random_normal_pair(state, &values[n - 1], &discarded);
+    }
+}
+
+/*
+ * Fills an array with n random double-precision floating point values from
+ * the (zero-mean, unit variance) standard normal distribution.
+ *
+ * Equivalent to filling consecutive pairs of array entries with calls to
+ * random_normal_pair, with the same ordering semantics as random_int32_array
+ * and, if n is odd, one entry set to the first value of a further pair.
+ * Blocks of uniform values are generated in the array with
+ * random_uniform_array and transformed in place.
+ *
+ * Without carry_normals the odd entry is the last and the second value of
+ * its pair is discarded. With carry_normals values are taken in the order of
+ * the current direction (ascending index forward, descending reversed) from
+ * a single sequence of normal values: a spare value held by the state fills
+ * the first entry in that order and, if the remaining entries are odd in
+ * number, the last entry in that order is set from a further pair with the
+ * other value held as the spare. As random_normal_pair generates the same
+ * pair forward and reversed, but with the values consumed in opposite
+ * orders, a reversed draw of the same size then regenerates the array.
+ */
+void revrand_random_normal_array(rng_state *state, double *values, size_t n)
+{
+    size_t lo = 0, hi = n;
+    double *spare = state->spare_normals;
+    if (state->carry_normals == 0) {
+        normal_pairs_array(state, values, n);
+        return;
+    }
+    if (n > 0 && state->has_spare_normal != 0) {
+        if (state->reversed == 0) {
+            values[lo++] = spare[0];
+        }
+        else {
+            values[--hi] = spare[0];
+        }
+        state->has_spare_normal = 0;
+    }
+    if ((hi - lo) & 1) {
+        if (state->reversed == 0) {
+            normal_pairs_array(state, &values[lo], hi - lo - 1);
+            revrand_random_normal_pair(state, &spare[1], &spare[0]);
+            values[hi - 1] = spare[1];
+        }
+        else {
+            normal_pairs_array(state, &values[lo + 1], hi - lo - 1);
+            revrand_random_normal_pair(state, &spare[0], &spare[1]);
+            values[lo] = spare[1];
+        }
+        state->has_spare_normal = 1;
+    }
+    else {
+        normal_pairs_array(state, &values[lo], hi - lo);
+    }
+}
+
+/*
+ * Generate a random double-precision floating point value from the standard
+ * normal distribution.
+ *
+ * Without carry_normals the first value of a pair from random_normal_pair,
+ * with the second discarded, and with carry_normals a spare value if held,
+ * else one value of a new pair with the other kept as the spare, so that
+ * successive calls use both values of each pair.
+ */
+double revrand_random_normal(rng_state *state)
+{
+    double value;
+    revrand_random_normal_array(state, &value, 1);
+    return value;
+}
+
+/*
+ * Applies the affine map x = mean + chol z in place to n vectors of length
+ * dim, with only the lower triangle of the row-major chol read.
+ *
+ * Rows are updated last to first so that each row is computed from entries
+ * of z which are not yet overwritten, avoiding a temporary vector.
+ */
+static void lower_triangular_affine_run(size_t dim, const double *mean,
+                                        const double *chol, double *values,
+                                        size_t n)
+{
+    size_t v, r, c;
+    double sum, *z;
+    for (v = 0; v < n; v++) {
+        z = &values[v * dim];
+        for (r = dim; r-- > 0;) {
+            sum = 0.;
+            for (c = 0; c <= r; c++) {
+                sum += chol[r * dim + c] * z[c];
+            }
+            z[r] = mean == NULL ? sum : mean[r] + sum;
+        }
+    }
+}
+
+/*
+ * Fills an array with n random vectors of length dim from the multivariate
+ * normal distribution with the given mean and lower-triangular Cholesky
+ * factor chol of the covariance.
+ *
+ * Equivalent to filling values with random_normal_array(state, values,
+ * n * dim) and then mapping each vector z to mean + chol z, so a draw of the
+ * same n in the reverse direction regenerates the array. The normal values
+ * are however generated in blocks of whole vectors of around KEY_LENGTH
+ * values (always an even number, so each block is the same sequence of pairs
+ * as in a single call), with each block transformed while in cache rather
+ * than in a second pass over the array. In the reverse direction the blocks
+ * are generated last to first, as random_normal_array does for its blocks.
+ * If mean is NULL a zero mean is used.
+ */
+void revrand_random_multivariate_normal(rng_state *state, size_t dim,
+                                        const double *mean,
+                                        const double *chol, double *values,
+                                        size_t n)
+{
+    size_t block_vectors, n_blocks, start, n_block, i;
+    if (dim == 0 || n == 0) {
+        return;
+    }
+    block_vectors = dim < KEY_LENGTH ? KEY_LENGTH / dim : 1;
+    if (block_vectors * dim & 1) {
+        block_vectors++;
+    }
+    /* blocks start at the same offsets in both directions so only the last
+       block may have an odd number of values */
+    n_blocks = (n + block_vectors - 1) / block_vectors;
+    for (i = 0; i < n_blocks; i++) {
+        start = (state->reversed == 0 ? i : n_blocks - 1 - i) * block_vectors;
+        n_block = n - start < block_vectors ? n - start : block_vectors;
+        revrand_random_normal_array(state, &values[start * dim],
+                                    n_block * dim);
+        lower_triangular_affine_run(dim, mean, chol, &values[start * dim],
+                                    n_block);
+    }
+}
+
+/*
+ * Box-Muller transforms n pairs of single-precision uniform values in place.
+ *
+ * The transform is computed in double-precision with the radius from 1 - u_r
+ * in (0, 1] so that a zero uniform value (with probability 2^-24) gives a
+ * zero rather than infinite radius. The results are therefore correctly
+ * rounded in all but rare cases, with the radius bounded above by
+ * sqrt(48 log(2)) ~= 5.77 due to the 24-bit resolution of the uniform values.
+ */
+REVRAND_DISPATCH
+static void box_muller_float_run(float *values, size_t n)
+{
+    size_t i;
+    double u_r, u_theta, ret_1, ret_2;
+    for (i = 0; i < n; i++) {
+        u_r = 1. - values[2 * i];
+        u_theta = values[2 * i + 1];
+        box_muller(u_r, u_theta, &ret_1, &ret_2);
+        values[2 * i] = (float) ret_1;
+        values[2 * i + 1] = (float) ret_2;
+    }
+}
+
+/*
+ * Generate a pair of independent random single-precision floating point
+ * values from the standard normal distribution.
+ *
+ * As random_normal_pair but from a pair of random_uniform_float values, and
+ * so consuming two rather than four random integers per pair. Values are
+ * transformed as in box_muller_float_run so scalar and array draws agree.
+ */
+void revrand_random_normal_float_pair(rng_state *state, float *ret_1,
+                                      float *ret_2)
+{
+    float values[2];
+    if (state->reversed == 0){
+        values[0] = revrand_random_uniform_float(state);
+        values[1] = revrand_random_uniform_float(state);
+    }
+    else {
+        values[1] = revrand_random_uniform_float(state);
+        values[0] = revrand_random_uniform_float(state);
+    }
+    box_muller_float_run(values, 1);
+    *ret_1 = values[0];
+    *ret_2 = values[1];
+}
+
+/*
+ * Fills an array with n random single-precision floating point values from
+ * the standard normal distribution.
+ *
+ * As random_normal_array with pairs generated as by random_normal_float_pair.
+ */
+void revrand_random_normal_float_array(rng_state *state, float *values,
+                                       size_t n)
+{
+    size_t n_pairs = n / 2, start, n_block, i;
+    float discarded;
+    if (state->reversed != 0 && n & 1) {
+        revrand_random_normal_float_pair(state, &values[n - 1], &discarded);
+    }
+    for (i = 0; i < n_pairs; i += n_block) {
+        n_block = n_pairs - i < KEY_LENGTH / 2 ? n_pairs - i : KEY_LENGTH / 2;
+        start = state->reversed == 0 ? i : n_pairs - i - n_block;
+        revrand_random_uniform_float_array(state, &values[2 * start],
+                                           2 * n_block);
+        box_muller_float_run(&values[2 * start], n_block);
+    }
+    if (state->reversed == 0 && n & 1) {
+        revrand_random_normal_float_pair(state, &values[n - 1], &discarded);
+    }
+}
+
+/* Evaluates ratio of degree 7 polynomials with coefficients num and den. */
+static inline double rational(const double *num, const double *den, double r)
+{
+    int i;
+    double n = num[7], d = den[7];
+    for (i = 6; i >= 0; i--) {
+        n = n * r + num[i];
+        d = d * r + den[i];
+    }
+    return n / d;
+}
+
+/*
+ * Inverse of the standard normal cumulative distribution function at p in
+ * [0, 1), using the rational approximations of Wichura (1988) algorithm AS241
+ * (PPND16), with errors of less than 8 ulp (and typically less than 2 ulp).
+ * The central region |p - 1/2| <= 0.425 covering 85% of uniform values needs
+ * no transcendental function evaluations.
+ */
+static double normal_inverse_cdf(double p)
+{
+    double q = p - 0.5, r, value;
+    if (fabs(q) <= ICDF_SPLIT_Q) {
+        r = ICDF_CONST_R - q * q;
+        return q * rational(ICDF_A, ICDF_B, r);
+    }
+    if (p == 0.) {
+        return -HUGE_VAL;
+    }
+    r = sqrt(-log_unit(q < 0. ? p : 1. - p));
+    if (r <= ICDF_SPLIT_R) {
+        value = rational(ICDF_C, ICDF_D, r - ICDF_SHIFT_R);
+    }
+    else {
+        value = rational(ICDF_E, ICDF_F, r - ICDF_SPLIT_R);
+    }
+    return q < 0. ? -value : value;
+}
+
+/*
+ * Transforms n uniform values in [0, 1) in place to their inverse normal CDF
+ * values, exactly as normal_inverse_cdf.
+ *
+ * Rather than branching per value, the central region is first evaluated
+ * branch-free (so vectorized) for all values, with tail values kept and
+ * flagged. The flagged values, about 15% of the total, are then gathered in
+ * to a contiguous buffer, transformed by a branch-free evaluation of both
+ * tail approximations and scattered back. Each value is computed with the
+ * same operations as in normal_inverse_cdf, so the results are identical.
+ */
+REVRAND_DISPATCH
+static void normal_icdf_run(double *values, size_t n)
+{
+    double tails[KEY_LENGTH], u, q, r, mid, far;
+    uint16_t indices[KEY_LENGTH];
+    unsigned char is_tail[KEY_LENGTH];
+    size_t start, n_block, n_tails, i;
+    for (start = 0; start < n; start += n_block) {
+        n_block = n - start < KEY_LENGTH ? n - start : KEY_LENGTH;
+        for (i = 0; i < n_block; i++) {
+            u = values[start + i];
+            q = u - 0.5;
+            r = ICDF_CONST_R - q * q;
+            is_tail[i] = fabs(q) > ICDF_SPLIT_Q;
+            r = q * rational(ICDF_A, ICDF_B, r);
+            values[start + i] = is_tail[i] ? u : r;
+        }
+        n_tails = 0;
+        for (i = 0; i < n_block; i++) {
+            indices[n_tails] = (uint16_t) i;
+            n_tails += is_tail[i];
+        }
+        for (i = 0; i < n_tails; i++) {
+            tails[i] = values[start + indices[i]];
+        }
+        for (i = 0; i < n_tails; i++) {
+            u = tails[i];
+            q = u - 0.5;
+            r = sqrt(-log_unit(q < 0. ? u : 1. - u));
+            mid = rational(ICDF_C, ICDF_D, r - ICDF_SHIFT_R);
+            far = rational(ICDF_E, ICDF_F, r - ICDF_SPLIT_R);
+            mid = r <= ICDF_SPLIT_R ? mid : far;
+            mid = q < 0. ? -mid : mid;
+            tails[i] = u == 0. ? -HUGE_VAL : mid;
+        }
+        for (i = 0; i < n_tails; i++) {
+            values[start + indices[i]] = tails[i];
+        }
+    }
+}
+
+/*
+ * Generate a random double-precision floating point value from the (zero-mean,
+ * unit variance) standard normal distribution by inverse transform sampling.
+ *
+ * Each value is computed from a single random_uniform value, so unlike
+ * random_normal_pair values are not generated in pairs and no trigonometric
+ * functions are evaluated. Rejection samplers such as the Ziggurat method
+ * consume a variable number of random integers per value, which in reverse
+ * cannot be distinguished from integers consumed by other draws without
+ * recording the number consumed, hence a fixed consumption method is used.
+ */
+double revrand_random_normal_icdf(rng_state *state)
+{
+    return normal_inverse_cdf(revrand_random_uniform(state));
+}
+
+/*
+ * Fills an array with n random double-precision floating point values from
+ * the standard normal distribution by inverse transform sampling.
+ *
+ * Equivalent to n calls to random_normal_icdf with the same ordering semantics
+ * as random_int32_array. Blocks of uniform values are generated in the array
+ * with random_uniform_array and transformed in place by normal_icdf_run.
+ */
+void revrand_random_normal_icdf_array(rng_state *state, double *values,
+                                      size_t n)
+{
+    size_t start, n_block, i;
+    for (i = 0; i < n; i += n_block) {
+        n_block = n - i < KEY_LENGTH ? n - i : KEY_LENGTH;
+        start = state->reversed == 0 ? i : n - i - n_block;
+        revrand_random_uniform_array(state, &values[start], n_block);
+        normal_icdf_run(&values[start], n_block);
+    }
+}
+
+/*
+ * Initialises a batch of generators from an array of batch->n_streams seeds,
+ * with stream s in the same state as init_state(seeds[s], ...). The keys and
+ * seeds arrays of the batch must already be allocated.
+ *
+ * Each key row is computed from the previous row so the initialisation
+ * recurrence is evaluated across all streams at once.
+ */
+REVRAND_DISPATCH
+void revrand_init_batch(const unsigned long *seeds, rng_batch *batch)
+{
+    size_t s, n = batch->n_streams;
+    int pos;
+    uint32_t *row, *prev;
+    for (s = 0; s < n; s++) {
+        batch->seeds[s] = seeds[s] & INIT_MASK;
+        batch->keys[s] = (uint32_t) batch->seeds[s];
+    }
+    for (pos = 1; pos < KEY_LENGTH; pos++) {
+        prev = &batch->keys[(pos - 1) * n];
+        row = &batch->keys[pos * n];
+        for (s = 0; s < n; s++) {
+            row[s] = INIT_MULT * (prev[s] ^ (prev[s] >> 30)) + pos;
+        }
+    }
+    batch->pos = KEY_LENGTH;
+    batch->reversed = 0;
+    batch->n_twists = 0;
+}
+
+/* Twists all keys of a batch, as twist applied to each stream. */
+REVRAND_DISPATCH
+static void batch_twist(rng_batch *batch)
+{
+    size_t s, n = batch->n_streams;
+    int i;
+    uint32_t y, *row, *next, *mid;
+    for (i = 0; i < KEY_LENGTH; i++) {
+        row = &batch->keys[i * n];
+        next = &batch->keys[((i + 1) % KEY_LENGTH) * n];
+        mid = &batch->keys[((i + MID_OFFSET) % KEY_LENGTH) * n];
+        for (s = 0; s < n; s++) {
+            y = (row[s] & UPPER_MASK) | (next[s] & LOWER_MASK);
+            row[s] = mid[s] ^ (y >> 1) ^ (-(y & 1) & MATRIX_A);
+        }
+    }
+    batch->n_twists++;
+}
+
+/*
+ * Reverses twist of all keys of a batch, as reverse_twist applied to each
+ * stream. Streams are processed in blocks of BATCH_LANES with the same two
+ * pass structure as reverse_twist on each block.
+ */
+REVRAND_DISPATCH
+static void batch_reverse_twist(rng_batch *batch)
+{
+    size_t b, s, lanes, n = batch->n_streams;
+    int i;
+    uint32_t y[KEY_LENGTH][BATCH_LANES];
+    uint32_t *keys;
+#define KEY(i) (&keys[(i) * n])
+    for (b = 0; b < n; b += BATCH_LANES) {
+        lanes = n - b < BATCH_LANES ? n - b : BATCH_LANES;
+        keys = &batch->keys[b];
+        for (i = KEY_LENGTH - MID_OFFSET; i < KEY_LENGTH - 1; i++) {
+            for (s = 0; s < lanes; s++) {
+                y[i][s] = untwist(KEY(i)[s] ^
+                                  KEY(i + MID_OFFSET - KEY_LENGTH)[s]);
+            }
+        }
+        for (s = 0; s < lanes; s++) {
+            KEY(KEY_LENGTH - 1)[s] =
+                (((KEY(KEY_LENGTH - 1)[s] ^ KEY(MID_OFFSET - 1)[s]) << 1) &
+                 UPPER_MASK) | (y[KEY_LENGTH - 2][s] & LOWER_MASK);
+        }
+        for (i = KEY_LENGTH - MID_OFFSET + 1; i < KEY_LENGTH - 1; i++) {
+            for (s = 0; s < lanes; s++) {
+                KEY(i)[s] = (y[i][s] & UPPER_MASK) |
+                            (y[i - 1][s] & LOWER_MASK);
+            }
+        }
+        for (i = 0; i < KEY_LENGTH - MID_OFFSET; i++) {
+            for (s = 0; s < lanes; s++) {
+                y[i][s] = untwist(KEY(i)[s] ^ KEY(i + MID_OFFSET)[s]);
+            }
+        }
+        for (i = 1; i < KEY_LENGTH - MID_OFFSET + 1; i++) {
+            for (s = 0; s < lanes; s++) {
+                KEY(i)[s] = (y[i][s] & UPPER_MASK) |
+                            (y[i - 1][s] & LOWER_MASK);
+            }
+        }
+        for (s = 0; s < lanes; s++) {
+            KEY(0)[s] = (y[0][s] & UPPER_MASK) |
+                        (untwist(KEY(KEY_LENGTH - 1)[s] ^
+                                 KEY(MID_OFFSET - 1)[s]) & LOWER_MASK);
+        }
+    }
+#undef KEY
+    batch->n_twists--;
+}
+
+/*
+ * Returns the key row of the next value of each stream in the batch, moving
+ * to the next or previous key block as needed, and advances the position.
+ */
+static const uint32_t *batch_next_row(rng_batch *batch)
+{
+    size_t s;
+    if (batch->reversed == 0) {
+        if (batch->pos == KEY_LENGTH) {
+            batch_twist(batch);
+            batch->pos = 0;
+        }
+        return &batch->keys[batch->pos++ * batch->n_streams];
+    }
+    if (batch->pos == -1) {
+        batch_reverse_twist(batch);
+        batch->pos = KEY_LENGTH - 1;
+        /* reset initial key values to seeds as in prev_block */
+        if (batch->n_twists == 0) {
+            for (s = 0; s < batch->n_streams; s++) {
+                batch->keys[s] = (uint32_t) batch->seeds[s];
+            }
+        }
+    }
+    return &batch->keys[batch->pos-- * batch->n_streams];
+}
+
+/* Reverses direction of random number generation of all streams in batch. */
+void revrand_reverse_batch(rng_batch *batch)
+{
+    if (batch->reversed == 0) {
+        batch->reversed = 1;
+        batch->pos--;
+    }
+    else {
+        batch->reversed = 0;
+        batch->pos++;
+    }
+}
+
+/*
+ * Copies the state of stream s of a batch to state, such that subsequent
+ * draws from state equal those of stream s.
+ */
+void revrand_get_batch_state(const rng_batch *batch, size_t s,
+                             rng_state *state)
+{
+    int i;
+    state->seed = batch->seeds[s];
+    for (i = 0; i < KEY_LENGTH; i++) {
+        state->key[i] = batch->keys[i * batch->n_streams + s];
+    }
+    state->pos = batch->pos;
+    state->reversed = batch->reversed;
+    state->n_twists = batch->n_twists;
+    state->engine = REVRAND_ENGINE_MT19937;
+    state->carry_normals = 0;
+    state->has_spare_normal = 0;
+    state->checkpoints = NULL;
+    state->lookahead = NULL;
+    revrand_reset_counters(state);
+}
+
+/*
+ * Generates one random integer uniformly from range [0, 2^32 - 1] for each
+ * stream of the batch, with values[s] equal to random_int32 of stream s.
+ */
+REVRAND_DISPATCH
+void revrand_random_int32_batch(rng_batch *batch, uint32_t *values)
+{
+    size_t s;
+    const uint32_t *row = batch_next_row(batch);
+    for (s = 0; s < batch->n_streams; s++) {
+        values[s] = revrand_temper(row[s]);
+    }
+}
+
+/*
+ * Generates one random double-precision value uniformly on [0,1) for each
+ * stream of the batch, with values[s] equal to random_uniform of stream s.
+ *
+ * As the second row may only be available after a twist overwriting the
+ * first, the value of the first row is accumulated in values before the
+ * second is read. The sum of the two integer parts is exact so the result
+ * does not depend on the order they are added.
+ */
+REVRAND_DISPATCH
+void revrand_random_uniform_batch(rng_batch *batch, double *values)
+{
+    size_t s, n = batch->n_streams;
+    const uint32_t *row = batch_next_row(batch);
+    if (batch->reversed == 0) {
+        for (s = 0; s < n; s++) {
+            values[s] = (int32_t) (revrand_temper(row[s]) >>
+                                   RAND_DBL_SHIFT_A) * RAND_DBL_MUL;
+        }
+        row = batch_next_row(batch);
+        for (s = 0; s < n; s++) {
+            values[s] = (values[s] + (int32_t) (revrand_temper(row[s]) >>
+                                                RAND_DBL_SHIFT_B)) /
+                        RAND_DBL_DIV;
+        }
+    }
+    /* swap draw order in reverse direction */
+    else {
+        for (s = 0; s < n; s++) {
+            values[s] = (int32_t) (revrand_temper(row[s]) >> RAND_DBL_SHIFT_B);
+        }
+        row = batch_next_row(batch);
+        for (s = 0; s < n; s++) {
+            values[s] = ((int32_t) (revrand_temper(row[s]) >>
+                                    RAND_DBL_SHIFT_A) *
+                         RAND_DBL_MUL + values[s]) / RAND_DBL_DIV;
+        }
+    }
+}
+
+/*
+ * Generates one random double-precision value from the standard normal
+ * distribution for each stream of the batch, with values[s] equal to
+ * random_normal_icdf of stream s.
+ */
+void revrand_random_normal_icdf_batch(rng_batch *batch, double *values)
+{
+    revrand_random_uniform_batch(batch, values);
+    normal_icdf_run(values, batch->n_streams);
 }
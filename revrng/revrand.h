@@ -69,44 +69,511 @@
  * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
  * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Algorithm and constants used in the log_unit implementation from fdlibm.
+ *
+ * Copyright (C) 1993 by Sun Microsystems, Inc. All rights reserved.
+ *
+ * Developed at SunSoft, a Sun Microsystems, Inc. business.
+ * Permission to use, copy, modify, and distribute this
+ * software is freely granted, provided that this notice
+ * is preserved.
  */
 
+ #ifndef REVRAND_H
+ #define REVRAND_H
+
+ #include <stddef.h>
+ #include <stdint.h>
+
+ #ifdef __cplusplus
+ extern "C" {
+ #endif
+
  /* Mersenne-Twister (MT-19937) key/state length */
- #define KEY_LENGTH 624
+ #define REVRAND_KEY_LENGTH 624
+
+ /*
+  * Generators of key blocks: Mersenne-Twister twists each key from the last,
+  * while Philox4x32-10 computes each key directly from the seed and key
+  * index as a counter-based generator, so moving between any keys is O(1).
+  */
+ #define REVRAND_ENGINE_MT19937 0
+ #define REVRAND_ENGINE_PHILOX 1
+
+ /* Mersenne-Twister tempering constants */
+ #define REVRAND_TEMPER_SHIFT_A 11
+ #define REVRAND_TEMPER_SHIFT_B 7
+ #define REVRAND_TEMPER_SHIFT_C 15
+ #define REVRAND_TEMPER_SHIFT_D 18
+ #define REVRAND_TEMPER_MASK_B 0x9d2c5680UL
+ #define REVRAND_TEMPER_MASK_C 0xefc60000UL
+
+ /* (int32, int32) -> double constants */
+ #define REVRAND_DBL_SHIFT_A 5
+ #define REVRAND_DBL_SHIFT_B 6
+ #define REVRAND_DBL_MUL 67108864.0
+ #define REVRAND_DBL_DIV 9007199254740992.0
+ /* 67108864 = 0x4000000, 9007199254740992 = 0x20000000000000 */
+
+ /* int32 -> float constants */
+ #define REVRAND_FLT_SHIFT 8
+ #define REVRAND_FLT_DIV 16777216.0f
+ /* 16777216 = 0x1000000 */
+
+ /*
+  * Cache of keys saved at twist boundaries, in caller allocated arrays. Keys
+  * are saved in slot n_twists % capacity when twisted forward from or
+  * reverse twisted to, and reverse twists to a saved key copy it instead of
+  * recomputing it.
+  */
+ typedef struct rng_checkpoints_
+ {
+     uint32_t *keys; /* capacity * KEY_LENGTH words of saved keys */
+     long long *tags; /* n_twists of key saved in each slot, or -1 if empty */
+     size_t capacity; /* number of keys which can be saved */
+ } rng_checkpoints;
+
+ /*
+  * Caller allocated buffer holding one key computed ahead of use by
+  * prepare_block, so that moving to that block copies the key rather than
+  * twisting. Tagged with the n_twists of the key, or -1 if empty.
+  */
+ typedef struct rng_lookahead_
+ {
+     uint32_t key[REVRAND_KEY_LENGTH]; /* precomputed key */
+     long long tag; /* n_twists of precomputed key, or -1 if empty */
+ } rng_lookahead;
+
+ /*
+  * Counts of generator work since a state was initialised or its counters
+  * reset, only updated if the library is compiled with REVRAND_COUNTERS
+  * defined. Read with get_counters, as random integers drawn since the last
+  * reversal or jump are only added to forward_words / reverse_words then.
+  */
+ typedef struct rng_counters_
+ {
+     long long twists; /* forward twists computed */
+     long long reverse_twists; /* reverse twists computed */
+     long long checkpoint_loads; /* reverse twists loaded from checkpoints */
+     long long lookahead_loads; /* block moves loaded from lookahead */
+     long long jumps; /* polynomial jumps of key */
+     long long forward_words; /* random integers drawn in forward direction */
+     long long reverse_words; /* random integers drawn in reverse direction */
+     long long reversals; /* calls to reverse */
+     long long word_mark; /* stream index words drawn are counted from */
+ } rng_counters;
 
  /* Internal random number generator state. */
  typedef struct rng_state_
  {
      unsigned long seed; /* integer seed used to initialise state */
-     unsigned long key[KEY_LENGTH]; /* Mersenne-Twister state */
+     uint32_t key[REVRAND_KEY_LENGTH]; /* Mersenne-Twister state */
      int pos; /* current position in key array */
      int reversed; /* ==0: forward state updates, !=0: reverse state updates */
-     int n_twists; /* number of twists performed */
+     long long n_twists; /* number of twists performed */
+     int engine; /* REVRAND_ENGINE_* generator of key blocks */
+     int carry_normals; /* !=0: spare normal values kept, see random_normal */
+     int has_spare_normal; /* !=0: spare_normals[0] is next normal value */
+     double spare_normals[2]; /* spare normal value and its pair partner */
+     rng_checkpoints *checkpoints; /* optional key cache, NULL if unused */
+     rng_lookahead *lookahead; /* optional next key, NULL if unused */
+     rng_counters counters; /* counts of generator work */
  } rng_state;
 
- /* Initialise generator state from an integer seed. */
- void init_state(unsigned long seed, rng_state *state);
+ /*
+  * Batch of generators advancing in lockstep, one value drawn from each per
+  * call, with keys stored interleaved so that word i of stream s is
+  * keys[i * n_streams + s] and twists are vectorized across streams.
+  */
+ typedef struct rng_batch_
+ {
+     size_t n_streams; /* number of generators in batch */
+     uint32_t *keys; /* KEY_LENGTH * n_streams interleaved key words */
+     unsigned long *seeds; /* n_streams integer seeds */
+     int pos; /* current position in keys, shared by all streams */
+     int reversed; /* ==0: forward state updates, !=0: reverse state updates */
+     long long n_twists; /* number of twists performed */
+ } rng_batch;
+
+ /*
+  * Table of a generator state and scalar generator functions, allowing other
+  * extension modules to draw values without linking against this library.
+  * The functions are called with state as their first argument.
+  */
+ typedef struct rng_interface_
+ {
+     rng_state *state; /* generator state to pass to functions */
+     unsigned long (*random_int32)(rng_state *state);
+     uint64_t (*random_int64)(rng_state *state);
+     uint32_t (*random_bounded)(rng_state *state, uint64_t bound);
+     double (*random_uniform)(rng_state *state);
+     float (*random_uniform_float)(rng_state *state);
+     void (*random_normal_pair)(rng_state *state, double *ret_1,
+                                double *ret_2);
+     double (*random_normal_icdf)(rng_state *state);
+     void (*reverse)(rng_state *state);
+     void (*jump)(rng_state *state, long long n);
+ } rng_interface;
+
+ /*
+  * Initialise generator state from an integer seed, with no checkpoints or
+  * lookahead.
+  */
+ void revrand_init_state(unsigned long seed, rng_state *state);
+
+ /*
+  * Initialise generator state from an integer seed with key blocks generated
+  * by Philox4x32-10 rather than Mersenne-Twister. All other functions taking
+  * a state then generate the Philox stream of the seed.
+  */
+ void revrand_init_philox_state(unsigned long seed, rng_state *state);
+
+ /*
+  * Initialises n states from an array of integer seeds, equivalent to but
+  * quicker than calling init_state for each seed in turn.
+  */
+ void revrand_init_states(const unsigned long *seeds, rng_state *states,
+                          size_t n);
+
+ /*
+  * Empties all slots of a checkpoint cache, which must be done before first
+  * use and whenever the key of a state using it is set other than by
+  * generating values or jumping.
+  */
+ void revrand_clear_checkpoints(rng_checkpoints *checkpoints);
+
+ /*
+  * Empties a lookahead buffer, which must be done before first use and
+  * whenever the key of a state using it is set other than by generating
+  * values or jumping.
+  */
+ void revrand_clear_lookahead(rng_lookahead *lookahead);
+
+ /*
+  * Computes the key of the block adjacent to the current block of state in
+  * its current direction in to lookahead, so that the next block move of a
+  * state using lookahead copies the key instead of twisting. Only reads
+  * state, so may run (e.g. in another thread) while values are drawn from
+  * the current block, but must complete before a draw leaves the block.
+  */
+ void revrand_prepare_block(const rng_state *state, rng_lookahead *lookahead);
+
+ /* Non-zero if compiled with REVRAND_COUNTERS so counters are updated. */
+ int revrand_counters_enabled(void);
+
+ /*
+  * Zeroes all counters of a state, which must be done whenever its key
+  * position is set other than by generating values or jumping.
+  */
+ void revrand_reset_counters(rng_state *state);
+
+ /* Copies counters of a state, including random integers drawn so far. */
+ void revrand_get_counters(const rng_state *state, rng_counters *counters);
+
+ /*
+  * Sets the counters of state to those of base plus the counts accumulated by
+  * each of n copies of base since they were copied.
+  */
+ void revrand_merge_counters(rng_state *state, const rng_state *base,
+                             const rng_state *copies, size_t n);
 
  /* Optimised implementation of reference Mersenne-Twister from Random Kit. */
- void twist(rng_state *state);
+ void revrand_twist(rng_state *state);
 
  /* Reverses twist of state: reverse_twist(twist(state)) is identity map. */
- void reverse_twist(rng_state *state);
+ void revrand_reverse_twist(rng_state *state);
 
  /* Reverses direction of random number generation. */
- void reverse(rng_state *state);
+ void revrand_reverse(rng_state *state);
+
+ /*
+  * Jumps state by n random integers: for n >= 0 equivalent to n discarded
+  * random_int32 calls, for n < 0 to rewinding -n previously generated values.
+  */
+ void revrand_jump(rng_state *state, long long n);
+
+ /*
+  * Generates values k0 to k1 - 1 (0 <= k0 <= k1) of the stream of random
+  * integers generated forward from the seed of state, value 0 being the first
+  * generated after init_state, in to values. State is moved (by jumping or
+  * from its checkpoint cache) as if the values had just been generated in its
+  * current direction, so can be kept as a cursor for nearby ranges. As keys
+  * reached by moving before the initial key depend on the path taken, the
+  * state must not have been moved there since init_state, and must not share
+  * its checkpoint cache with a state which may have been.
+  */
+ void revrand_fill_range(rng_state *state, long long k0, long long k1,
+                         uint32_t *values);
+
+ /* Returns value k >= 0 of the stream of state's seed, moving state. */
+ uint32_t revrand_value_at(rng_state *state, long long k);
+
+ /*
+  * Initialises n_streams states from seed with states[i] equal to the seed
+  * state after i * stream_twists twists, for use as non-overlapping streams.
+  */
+ void revrand_init_streams(unsigned long seed, rng_state *states,
+                           size_t n_streams,
+                           long long stream_twists);
 
- /* Generates a random integer uniformly from range [0, 2^32 - 1]. */
- unsigned long random_int32(rng_state *state);
+ /*
+  * Moves to start of next key block / end of previous key block, twisting /
+  * reverse-twisting state. Used by the inline generator functions below.
+  */
+ void revrand_next_block(rng_state *state);
+ void revrand_prev_block(rng_state *state);
+
+ /* Applies Mersenne-Twister tempering transform to a key value. */
+ static inline uint32_t revrand_temper(uint32_t y)
+ {
+     y ^= (y >> REVRAND_TEMPER_SHIFT_A);
+     y ^= (y << REVRAND_TEMPER_SHIFT_B) & REVRAND_TEMPER_MASK_B;
+     y ^= (y << REVRAND_TEMPER_SHIFT_C) & REVRAND_TEMPER_MASK_C;
+     y ^= (y >> REVRAND_TEMPER_SHIFT_D);
+     return y;
+ }
+
+ /*
+  * Generates a random integer uniformly from range [0, 2^32 - 1].
+  *
+  * Defined inline so callers' loops only call in to the library once per
+  * key block, when the key is twisted / reverse-twisted.
+  */
+ static inline unsigned long revrand_random_int32(rng_state *state)
+ {
+     /* if forward direction and at end of key, twist */
+     if (state->reversed == 0) {
+         if (state->pos == REVRAND_KEY_LENGTH) {
+             revrand_next_block(state);
+         }
+         return revrand_temper(state->key[state->pos++]);
+     }
+     /* if reverse direction and at beginning of key, reverse-twist */
+     else {
+         if (state->pos == -1) {
+             revrand_prev_block(state);
+         }
+         return revrand_temper(state->key[state->pos--]);
+     }
+ }
+
+ /*
+  * Fills array with n random integers uniformly from range [0, 2^32 - 1],
+  * written to increasing indices in forward direction and decreasing indices
+  * in reverse direction.
+  */
+ void revrand_random_int32_array(rng_state *state, unsigned long *values,
+                                 size_t n);
+
+ /*
+  * Fills array with n random 32-bit unsigned integers, as random_int32_array
+  * but with values packed in to uint32_t entries.
+  */
+ void revrand_random_uint32_array(rng_state *state, uint32_t *values,
+                                  size_t n);
+
+ /*
+  * Generates a random integer uniformly from range [0, 2^64 - 1] from two
+  * consecutive random integers, upper 32 bits first, with the draw order
+  * swapped in the reverse direction.
+  */
+ static inline uint64_t revrand_random_int64(rng_state *state)
+ {
+     uint64_t upper, lower;
+     if (state->reversed == 0) {
+         upper = revrand_random_int32(state);
+         lower = revrand_random_int32(state);
+     }
+     else {
+         lower = revrand_random_int32(state);
+         upper = revrand_random_int32(state);
+     }
+     return (upper << 32) | lower;
+ }
+
+ /*
+  * Fills array with n random integers uniformly from range [0, 2^64 - 1],
+  * with same ordering as random_int32_array.
+  */
+ void revrand_random_int64_array(rng_state *state, uint64_t *values, size_t n);
+
+ /*
+  * Generates a random integer from range [0, bound - 1] for 1 <= bound <= 2^32
+  * by multiply-shift reduction of a random_int64 value.
+  */
+ uint32_t revrand_random_bounded(rng_state *state, uint64_t bound);
+
+ /*
+  * Fills array with n random integers from range [0, bound - 1], with same
+  * ordering as random_int32_array.
+  */
+ void revrand_random_bounded_array(rng_state *state, uint64_t bound,
+                                   uint32_t *values,
+                                   size_t n);
+
+ /*
+  * Fills array with n masks of 32 independent Bernoulli variables each set
+  * with probability p / 2^32 for 0 <= p <= 2^32, with same ordering as
+  * random_int32_array.
+  */
+ void revrand_random_bernoulli_masks(rng_state *state, uint64_t p,
+                                     uint32_t *masks,
+                                     size_t n);
+
+ /*
+  * Number of random integers random_bernoulli_masks consumes per mask for
+  * probability p / 2^32, i.e. the number of bits of the binary fraction p /
+  * 2^32 (zero for p == 0 or p >= 2^32).
+  */
+ int revrand_bernoulli_words(uint64_t p);
 
  /*
   * Generate a random double-precision floating point value from uniform
-  * distribution on [0,1).
+  * distribution on [0,1) from two random integers, with the draw order
+  * swapped in the reverse direction.
+  */
+ static inline double revrand_random_uniform(rng_state *state)
+ {
+     long a, b;
+     if (state->reversed == 0) {
+         a = (long) (revrand_random_int32(state) >> REVRAND_DBL_SHIFT_A);
+         b = (long) (revrand_random_int32(state) >> REVRAND_DBL_SHIFT_B);
+     }
+     else {
+         b = (long) (revrand_random_int32(state) >> REVRAND_DBL_SHIFT_B);
+         a = (long) (revrand_random_int32(state) >> REVRAND_DBL_SHIFT_A);
+     }
+     return (a * REVRAND_DBL_MUL + b) / REVRAND_DBL_DIV;
+ }
+
+ /*
+  * Fills array with n random double-precision floating point values from
+  * uniform distribution on [0,1), with same ordering as random_int32_array.
+  */
+ void revrand_random_uniform_array(rng_state *state, double *values, size_t n);
+
+ /*
+  * Generate a random single-precision floating point value from uniform
+  * distribution on [0,1) from a single random integer.
+  */
+ static inline float revrand_random_uniform_float(rng_state *state)
+ {
+     return (int32_t) (revrand_random_int32(state) >> REVRAND_FLT_SHIFT) /
+            REVRAND_FLT_DIV;
+ }
+
+ /*
+  * Fills array with n random single-precision floating point values from
+  * uniform distribution on [0,1), with same ordering as random_int32_array.
   */
- double random_uniform(rng_state *state);
+ void revrand_random_uniform_float_array(rng_state *state, float *values,
+                                         size_t n);
 
  /*
   * Generate a pair of independent random double-precision floating point
   * values from the (zero-mean, unit variance) standard normal distribution.
   */
- void random_normal_pair(rng_state *state, double *ret_1, double *ret_2);
+ void revrand_random_normal_pair(rng_state *state, double *ret_1,
+                                 double *ret_2);
+
+ /*
+  * Generate a random double-precision floating point value from the standard
+  * normal distribution, equal to random_normal_array(state, &value, 1).
+  */
+ double revrand_random_normal(rng_state *state);
+
+ /*
+  * Fills array with n random double-precision floating point values from the
+  * standard normal distribution, as by filling consecutive pairs of entries
+  * with random_normal_pair, with same ordering as random_int32_array.
+  *
+  * If the carry_normals field of state is zero (as set by init_state) the
+  * second value of the pair generated for an odd final entry is discarded.
+  * Otherwise it is kept in state as a spare and used for the next normal
+  * value, so that successive draws (for example of single values) are
+  * entries of one sequence of normal values generated in pairs. Reversal
+  * then remains exact provided no other values are drawn from the state
+  * and it is not jumped while it holds a spare (has_spare_normal != 0).
+  */
+ void revrand_random_normal_array(rng_state *state, double *values, size_t n);
+
+ /*
+  * Fills array with n random vectors of length dim (stored consecutively)
+  * from the multivariate normal distribution with mean vector mean (or zero
+  * if NULL) and covariance chol chol^T, for the dim by dim row-major
+  * lower-triangular chol (with the upper triangle not read). Equivalent to
+  * mapping each vector z of random_normal_array(state, values, n * dim) to
+  * mean + chol z, with each block of values transformed as generated.
+  */
+ void revrand_random_multivariate_normal(rng_state *state, size_t dim,
+                                         const double *mean,
+                                         const double *chol, double *values,
+                                         size_t n);
+
+ /*
+  * Generate a pair of independent random single-precision floating point
+  * values from the standard normal distribution from two random integers.
+  */
+ void revrand_random_normal_float_pair(rng_state *state, float *ret_1,
+                                       float *ret_2);
+
+ /*
+  * Fills array with n random single-precision floating point values from the
+  * standard normal distribution, as by filling consecutive pairs of entries
+  * with random_normal_float_pair, with same ordering as random_int32_array.
+  */
+ void revrand_random_normal_float_array(rng_state *state, float *values,
+                                        size_t n);
+
+ /*
+  * Generate a random double-precision floating point value from the standard
+  * normal distribution by inverse transform sampling of a single uniform.
+  */
+ double revrand_random_normal_icdf(rng_state *state);
+
+ /*
+  * Fills array with n random double-precision floating point values from the
+  * standard normal distribution by inverse transform sampling, with same
+  * ordering as random_int32_array.
+  */
+ void revrand_random_normal_icdf_array(rng_state *state, double *values,
+                                       size_t n);
+
+ /*
+  * Initialises a batch with stream s in the state init_state(seeds[s], ...)
+  * would give, with the n_streams, keys and seeds fields already set.
+  */
+ void revrand_init_batch(const unsigned long *seeds, rng_batch *batch);
+
+ /* Reverses direction of random number generation of all streams in batch. */
+ void revrand_reverse_batch(rng_batch *batch);
+
+ /* Copies the state of stream s of a batch in to state. */
+ void revrand_get_batch_state(const rng_batch *batch, size_t s,
+                              rng_state *state);
+
+ /*
+  * Generates one random integer uniformly from range [0, 2^32 - 1] for each
+  * stream of a batch, with values[s] as random_int32 of stream s.
+  */
+ void revrand_random_int32_batch(rng_batch *batch, uint32_t *values);
+
+ /*
+  * Generates one random double-precision value uniformly on [0,1) for each
+  * stream of a batch, with values[s] as random_uniform of stream s.
+  */
+ void revrand_random_uniform_batch(rng_batch *batch, double *values);
+
+ /*
+  * Generates one random double-precision value from the standard normal
+  * distribution for each stream of a batch, with values[s] as
+  * random_normal_icdf of stream s.
+  */
+ void revrand_random_normal_icdf_batch(rng_batch *batch, double *values);
+
+ #ifdef __cplusplus
+ }
+ #endif
+
+ #endif /* REVRAND_H */
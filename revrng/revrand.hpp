@@ -0,0 +1,272 @@
+/*
+ * C++ engine interface to the reversible Mersenne-Twister generator.
+ *
+ * Author: Matt Graham (matt-graham.github.io)
+ *
+ * Header-only wrapper of the rng_state generator of revrand.h as a class
+ * template satisfying the UniformRandomBitGenerator requirements, so it can
+ * be used with the <random> distributions. The direction of state updates is
+ * a template parameter rather than a runtime flag, so the generation of each
+ * value has no direction branch, with reverse() returning an engine of the
+ * opposite direction in the same state. Requires C++11 and linking against
+ * the revrand library.
+ *
+ *   revrand::reversible_mt19937 engine(12345);
+ *   std::normal_distribution<double> normal;
+ *   double x = normal(engine);
+ *   auto reversed = engine.reverse();
+ */
+
+#ifndef REVRAND_HPP
+#define REVRAND_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "revrand.h"
+
+namespace revrand {
+
+/* Direction of generator state updates. */
+enum class direction { forward, reverse };
+
+/* Direction opposite to d. */
+constexpr direction opposite(direction d)
+{
+    return d == direction::forward ? direction::reverse : direction::forward;
+}
+
+/*
+ * Reversible MT-19937 engine generating 32-bit values in direction D.
+ *
+ * Values are equal to those of revrand_random_int32 on a state in the same
+ * direction, so an engine created by reverse() regenerates the values
+ * generated before the call in reverse order.
+ */
+template <direction D>
+class basic_reversible_mt19937
+{
+public:
+    typedef std::uint32_t result_type;
+
+    static constexpr direction update_direction = D;
+    static constexpr std::size_t key_length = REVRAND_KEY_LENGTH;
+    static constexpr result_type default_seed = 5489u;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xffffffffu; }
+
+    /* Engine in the state revrand_init_state gives with seed, in D. */
+    explicit basic_reversible_mt19937(unsigned long seed = default_seed)
+    {
+        this->seed(seed);
+    }
+
+    /*
+     * Engine with a copy of a C Mersenne-Twister generator state, which must
+     * be in direction D. The state's checkpoint cache, if any, is not used,
+     * and as the engine draws only integers any spare normal value is dropped.
+     *
+     * Throws std::invalid_argument if the state is in the other direction or
+     * uses another engine.
+     */
+    explicit basic_reversible_mt19937(const rng_state &state)
+        : state_(state)
+    {
+        if ((state.reversed != 0) != (D == direction::reverse)) {
+            throw std::invalid_argument(
+                "State direction does not match engine direction");
+        }
+        if (state.engine != REVRAND_ENGINE_MT19937) {
+            throw std::invalid_argument(
+                "State is not a Mersenne-Twister state");
+        }
+        state_.checkpoints = NULL;
+        state_.lookahead = NULL;
+        state_.carry_normals = 0;
+        state_.has_spare_normal = 0;
+    }
+
+    /* Reinitialises state from an integer seed, in direction D. */
+    void seed(unsigned long seed = default_seed)
+    {
+        revrand_init_state(seed, &state_);
+        if (D == direction::reverse) {
+            revrand_reverse(&state_);
+        }
+    }
+
+    /* Generates the next random integer in direction D. */
+    result_type operator()()
+    {
+        if (D == direction::forward) {
+            if (state_.pos == REVRAND_KEY_LENGTH) {
+                revrand_next_block(&state_);
+            }
+            return revrand_temper(state_.key[state_.pos++]);
+        }
+        else {
+            if (state_.pos == -1) {
+                revrand_prev_block(&state_);
+            }
+            return revrand_temper(state_.key[state_.pos--]);
+        }
+    }
+
+    /*
+     * Writes n values to first and returns the output iterator after them,
+     * with the same values as n calls to operator() in order. Whole key
+     * blocks are generated in loops of constant length key_length.
+     */
+    template <class OutputIt>
+    OutputIt generate(OutputIt first, std::size_t n)
+    {
+        while (n > 0) {
+            if (at_block_end()) {
+                next_block();
+            }
+            std::size_t run = words_left();
+            if (run == key_length && n >= key_length) {
+                first = temper_block(first);
+                n -= key_length;
+                continue;
+            }
+            if (run > n) {
+                run = n;
+            }
+            first = temper_run(first, run);
+            n -= run;
+        }
+        return first;
+    }
+
+    /*
+     * As generate for an output iterator, for contiguous arrays using the
+     * vectorized revrand_random_uint32_array, which in the reverse direction
+     * fills arrays from their end so the values are then reversed in place.
+     */
+    result_type *generate(result_type *first, std::size_t n)
+    {
+        revrand_random_uint32_array(&state_, first, n);
+        if (D == direction::reverse) {
+            std::reverse(first, first + n);
+        }
+        return first + n;
+    }
+
+    /* Discards the next n values in direction D by jumping the state. */
+    void discard(unsigned long long n)
+    {
+        revrand_jump(&state_, static_cast<long long>(n));
+    }
+
+    /* Rewinds the state by n values, undoing n calls to operator(). */
+    void rewind(unsigned long long n)
+    {
+        revrand_jump(&state_, -static_cast<long long>(n));
+    }
+
+    /*
+     * Returns an engine in the opposite direction whose first values are the
+     * last generated by this engine, in reverse order.
+     */
+    basic_reversible_mt19937<opposite(D)> reverse() const
+    {
+        rng_state reversed = state_;
+        revrand_reverse(&reversed);
+        return basic_reversible_mt19937<opposite(D)>(reversed);
+    }
+
+    /* Underlying C generator state. */
+    const rng_state &state() const { return state_; }
+
+    friend bool operator==(const basic_reversible_mt19937 &a,
+                           const basic_reversible_mt19937 &b)
+    {
+        return a.state_.pos == b.state_.pos &&
+               a.state_.n_twists == b.state_.n_twists &&
+               a.state_.seed == b.state_.seed &&
+               std::memcmp(a.state_.key, b.state_.key,
+                           sizeof(a.state_.key)) == 0;
+    }
+
+    friend bool operator!=(const basic_reversible_mt19937 &a,
+                           const basic_reversible_mt19937 &b)
+    {
+        return !(a == b);
+    }
+
+private:
+    rng_state state_;
+
+    bool at_block_end() const
+    {
+        return D == direction::forward ? state_.pos == REVRAND_KEY_LENGTH
+                                       : state_.pos == -1;
+    }
+
+    void next_block()
+    {
+        if (D == direction::forward) {
+            revrand_next_block(&state_);
+        }
+        else {
+            revrand_prev_block(&state_);
+        }
+    }
+
+    /* Number of values left in current key block in direction D. */
+    std::size_t words_left() const
+    {
+        return D == direction::forward
+            ? static_cast<std::size_t>(REVRAND_KEY_LENGTH - state_.pos)
+            : static_cast<std::size_t>(state_.pos + 1);
+    }
+
+    /* Tempers n values from current position in direction D to out. */
+    template <class OutputIt>
+    OutputIt temper_run(OutputIt out, std::size_t n)
+    {
+        const std::uint32_t *key = state_.key + state_.pos;
+        for (std::size_t i = 0; i < n; i++) {
+            *out++ = revrand_temper(D == direction::forward ? key[i]
+                                                            : *(key - i));
+        }
+        state_.pos += D == direction::forward ? static_cast<int>(n)
+                                              : -static_cast<int>(n);
+        return out;
+    }
+
+    /* Tempers a whole key block in direction D to out. */
+    template <class OutputIt>
+    OutputIt temper_block(OutputIt out)
+    {
+        const std::uint32_t *key = state_.key;
+        for (std::size_t i = 0; i < key_length; i++) {
+            *out++ = revrand_temper(D == direction::forward
+                                    ? key[i] : key[key_length - 1 - i]);
+        }
+        state_.pos = D == direction::forward ? REVRAND_KEY_LENGTH : -1;
+        return out;
+    }
+};
+
+template <direction D>
+constexpr direction basic_reversible_mt19937<D>::update_direction;
+template <direction D>
+constexpr std::size_t basic_reversible_mt19937<D>::key_length;
+template <direction D>
+constexpr typename basic_reversible_mt19937<D>::result_type
+    basic_reversible_mt19937<D>::default_seed;
+
+/* Engine generating in the forward direction, as std::mt19937. */
+typedef basic_reversible_mt19937<direction::forward> reversible_mt19937;
+
+/* Engine generating in the reverse direction. */
+typedef basic_reversible_mt19937<direction::reverse> reversed_mt19937;
+
+} /* namespace revrand */
+
+#endif /* REVRAND_HPP */
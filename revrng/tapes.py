@@ -0,0 +1,374 @@
+""" Streaming random value tapes regenerable from a small header. """
+
+__authors__ = 'Matt Graham'
+__license__ = 'MIT'
+
+import os
+import numpy as np
+from revrng.numpy_wrapper import ReversibleRandomState
+
+TAPE_MAGIC = b'REVRNGT1'
+TAPE_VERSION = 1
+# header padded to a page so values in a memory-mapped tape are page aligned
+HEADER_SIZE = 4096
+HEADER_DTYPE = np.dtype([
+    ('magic', 'S8'),
+    ('version', '=u4'),
+    ('kind', '=u4'),
+    ('n_values', '=u8'),
+    ('chunk_size', '=u8'),
+    ('seed', '=u8'),
+    ('n_twists', '=i8'),
+    ('pos', '=i4'),
+    ('reversed', '=i4'),
+    ('key', '=u4', (624,)),
+    ('engine', '=u4')
+])
+
+# name, dtype, random integers used per value, method, method keyword
+# arguments and whether values are generated in pairs, indexed by kind code
+KINDS = (
+    ('int32', np.uint32, 1, 'random_int32', {'dtype': np.uint32}, False),
+    ('int64', np.uint64, 2, 'random_int64', {}, False),
+    ('uniform', np.float64, 2, 'standard_uniform', {}, False),
+    ('uniform_float32', np.float32, 1, 'standard_uniform',
+     {'dtype': np.float32}, False),
+    ('normal', np.float64, 2, 'standard_normal', {}, True),
+    ('normal_float32', np.float32, 1, 'standard_normal',
+     {'dtype': np.float32}, True),
+    ('normal_icdf', np.float64, 2, 'standard_normal',
+     {'method': 'inverse_cdf'}, False),
+)
+KIND_CODES = dict((kind[0], code) for code, kind in enumerate(KINDS))
+# generator engines, indexed by engine code
+ENGINE_NAMES = ('mt19937', 'philox')
+ENGINE_CODES = dict((name, code) for code, name in enumerate(ENGINE_NAMES))
+
+
+class Tape(object):
+    """
+    Tape of random values generated in chunks from a recorded start state.
+
+    A tape is defined by the state of a generator when the tape was started,
+    the kind and number of values and the chunk size, which together need
+    only `HEADER_SIZE` bytes to store. Any chunk of values can then be
+    regenerated on demand by jumping a copy of the start state to the start
+    of the chunk, and the whole tape can be replayed in either order without
+    storing the values themselves.
+    """
+
+    def __init__(self, state, n_values, kind='uniform', chunk_size=2**20):
+        """
+        Tape of random values generated in chunks from a recorded start state.
+
+        Parameters
+        ----------
+        state : dict
+            Start state of tape in the format returned by
+            `ReversibleRandomState.get_state`.
+        n_values : int
+            Total number of values on tape.
+        kind : str
+            Kind of values on tape, one of `int32`, `int64` (generated by
+            `random_int32` with dtype uint32 and `random_int64`), `uniform`,
+            `uniform_float32` (by `standard_uniform` with float64 and float32
+            dtypes), `normal`, `normal_float32` (by `standard_normal` with the
+            `box_muller` method and float64 and float32 dtypes) or
+            `normal_icdf` (by `standard_normal` with the `inverse_cdf`
+            method).
+        chunk_size : int
+            Number of values in each chunk, other than the last chunk which
+            holds any remainder.
+
+        Raises
+        ------
+            ValueError: Unknown kind, negative number of values,
+                non-positive chunk size, odd number of values or chunk size
+                for kinds generated in pairs or `normal` tape from state
+                holding a spare normal value.
+        """
+        if kind not in KIND_CODES:
+            raise ValueError("Unknown tape kind {0}.".format(kind))
+        if n_values < 0:
+            raise ValueError("Number of values must be non-negative.")
+        if chunk_size < 1:
+            raise ValueError("Chunk size must be positive.")
+        _, dtype, words, method, kwargs, paired = KINDS[KIND_CODES[kind]]
+        if paired and (n_values % 2 != 0 or chunk_size % 2 != 0):
+            raise ValueError(
+                "Number of values and chunk size must be even for {0} tapes."
+                .format(kind))
+        if kind == 'normal' and state.get('spare_normal') is not None:
+            # spare would be the first value but is not recorded in header
+            raise ValueError(
+                "State of normal tape must not hold a spare normal value.")
+        self.state = {
+            'seed': int(state['seed']),
+            'key': np.array(state['key'], np.uint32),
+            'pos': int(state['pos']),
+            'reversed': 1 if state['reversed'] else 0,
+            'n_twists': int(state['n_twists']),
+            'engine': state.get('engine', 'mt19937')
+        }
+        self.n_values = int(n_values)
+        self.kind = kind
+        self.chunk_size = int(chunk_size)
+        self.dtype = np.dtype(dtype)
+        self.words_per_value = words
+        self._method = method
+        self._kwargs = kwargs
+
+    @property
+    def n_chunks(self):
+        """Number of chunks on tape."""
+        return -(-self.n_values // self.chunk_size)
+
+    def chunk_length(self, k):
+        """Number of values in chunk `k`."""
+        if k < 0 or k >= self.n_chunks:
+            raise IndexError("Chunk index out of range.")
+        return min(self.chunk_size, self.n_values - k * self.chunk_size)
+
+    def start_state(self, **kwargs):
+        """
+        Create generator in start state of tape.
+
+        Parameters
+        ----------
+        **kwargs
+            Options of generator as described for ReversibleRandomState.
+
+        Returns
+        -------
+        ReversibleRandomState
+            Generator which generates the tape values from its next draw.
+        """
+        state = ReversibleRandomState(
+            self.state['seed'], engine=self.state['engine'], **kwargs)
+        state.set_state(self.state)
+        return state
+
+    def draw(self, state, out):
+        """Generates values of tape kind in to `out` using `state`."""
+        return getattr(state, self._method)(out=out, **self._kwargs)
+
+    def chunk(self, k, out=None, **kwargs):
+        """
+        Regenerate chunk `k` of tape.
+
+        Parameters
+        ----------
+        k : int
+            Index of chunk in [0, n_chunks).
+        out : ndarray or None
+            Optional writeable array (or buffer) of tape dtype and of size
+            `chunk_length(k)` to regenerate values in to.
+        **kwargs
+            Options of generator used to regenerate values, for example
+            `n_threads`, as described for ReversibleRandomState.
+
+        Returns
+        -------
+        ndarray
+            Values of chunk (out if specified).
+
+        Raises
+        ------
+            IndexError: Chunk index out of range.
+        """
+        n = self.chunk_length(k)
+        if out is None:
+            out = np.empty(n, self.dtype)
+        state = self.start_state(**kwargs)
+        state.jump(k * self.chunk_size * self.words_per_value)
+        return self.draw(state, out)
+
+    def chunks(self, reverse=False, **kwargs):
+        """
+        Iterate over regenerated chunks of tape.
+
+        Each chunk is generated from the previous with a single generator, so
+        replaying a tape costs the same as generating it. With `reverse` the
+        generator is jumped to the end of the tape and reversed, so chunks are
+        regenerated last to first, each with its values in the same order as
+        when written, as an array draw on a reversed generator regenerates the
+        array of the matching forward draw.
+
+        Parameters
+        ----------
+        reverse : bool
+            Whether to iterate over the tape chunks in reverse order.
+        **kwargs
+            Options of generator used to regenerate values, for example
+            `n_threads`, as described for ReversibleRandomState.
+
+        Yields
+        ------
+        ndarray
+            Values of each chunk, in a new array for each chunk.
+        """
+        state = self.start_state(**kwargs)
+        indices = range(self.n_chunks)
+        if reverse:
+            state.jump(self.n_values * self.words_per_value)
+            state.reverse()
+            indices = reversed(indices)
+        for k in indices:
+            yield self.draw(state, np.empty(self.chunk_length(k), self.dtype))
+
+    def to_bytes(self):
+        """Serialises tape to a header of `HEADER_SIZE` bytes."""
+        header = np.zeros((), HEADER_DTYPE)
+        header['magic'] = TAPE_MAGIC
+        header['version'] = TAPE_VERSION
+        header['kind'] = KIND_CODES[self.kind]
+        header['n_values'] = self.n_values
+        header['chunk_size'] = self.chunk_size
+        header['seed'] = self.state['seed']
+        header['n_twists'] = self.state['n_twists']
+        header['pos'] = self.state['pos']
+        header['reversed'] = self.state['reversed']
+        header['key'] = self.state['key']
+        header['engine'] = ENGINE_CODES[self.state['engine']]
+        data = header.tobytes()
+        return data + b'\0' * (HEADER_SIZE - len(data))
+
+    @classmethod
+    def from_bytes(cls, data):
+        """
+        Deserialises tape from a header created by `to_bytes`.
+
+        Raises
+        ------
+            ValueError: Data too short, not a tape header or of an
+                unsupported version.
+        """
+        if len(data) < HEADER_DTYPE.itemsize:
+            raise ValueError("Tape header too short.")
+        header = np.frombuffer(data, HEADER_DTYPE, count=1)[0]
+        if header['magic'] != TAPE_MAGIC:
+            raise ValueError("Not a tape header.")
+        if header['version'] != TAPE_VERSION:
+            raise ValueError(
+                "Unsupported tape version {0}.".format(header['version']))
+        if header['kind'] >= len(KINDS):
+            raise ValueError(
+                "Unknown tape kind code {0}.".format(header['kind']))
+        if header['engine'] >= len(ENGINE_NAMES):
+            raise ValueError(
+                "Unknown tape engine code {0}.".format(header['engine']))
+        state = {
+            'seed': int(header['seed']),
+            'key': np.array(header['key'], np.uint32),
+            'pos': int(header['pos']),
+            'reversed': int(header['reversed']),
+            'n_twists': int(header['n_twists']),
+            'engine': ENGINE_NAMES[int(header['engine'])]
+        }
+        return cls(state, int(header['n_values']),
+                   KINDS[int(header['kind'])][0], int(header['chunk_size']))
+
+
+def _write_all(target, data):
+    """Writes all of data to a file descriptor or binary file object."""
+    data = memoryview(data).cast('B')
+    if isinstance(target, int):
+        while len(data) > 0:
+            data = data[os.write(target, data):]
+    else:
+        target.write(data)
+
+
+def write_tape(state, target, n_values, kind='uniform', chunk_size=2**20,
+               values=True):
+    """
+    Generate a tape of random values and stream it to a file or buffer.
+
+    The tape header recording the current state of the generator is written
+    first, followed by the values (in native byte order) generated chunk by
+    chunk with the bulk array methods of `state`, so at most one chunk is
+    held in memory. Writing to a buffer such as a writeable `mmap` generates
+    the values directly in to the buffer with no intermediate copy.
+
+    The values can later be regenerated from the header alone, read with
+    `read_tape`, so if `values` is False only the header is written.
+
+    Parameters
+    ----------
+    state : ReversibleRandomState
+        Generator to generate values with, which is advanced past the tape.
+    target : int, file or buffer
+        File descriptor, binary file object open for writing or writeable
+        buffer (e.g. `mmap`) of at least `HEADER_SIZE` bytes plus the size
+        of the values, to write tape to from its current position (start
+        for a buffer).
+    n_values, kind, chunk_size
+        Tape options as described for Tape.
+    values : bool
+        Whether to write values after header (default) or only the header.
+
+    Returns
+    -------
+    Tape
+        Tape written, for regenerating chunks.
+
+    Raises
+    ------
+        ValueError: Invalid tape options or buffer too small for tape.
+    """
+    tape = Tape(state.get_state(), n_values, kind, chunk_size)
+    header = tape.to_bytes()
+    if not isinstance(target, int) and not hasattr(target, 'write'):
+        buffer = np.frombuffer(target, np.uint8)
+        size = HEADER_SIZE + (tape.n_values * tape.dtype.itemsize
+                              if values else 0)
+        if buffer.size < size:
+            raise ValueError(
+                "Buffer of {0} bytes too small for tape of {1} bytes."
+                .format(buffer.size, size))
+        buffer[:HEADER_SIZE] = np.frombuffer(header, np.uint8)
+        if values:
+            data = np.frombuffer(target, tape.dtype, count=tape.n_values,
+                                 offset=HEADER_SIZE)
+            for k in range(tape.n_chunks):
+                start = k * tape.chunk_size
+                tape.draw(state, data[start:start + tape.chunk_length(k)])
+        return tape
+    _write_all(target, header)
+    if values and tape.n_chunks > 0:
+        chunk = np.empty(tape.chunk_length(0), tape.dtype)
+        for k in range(tape.n_chunks):
+            _write_all(target, tape.draw(state, chunk[:tape.chunk_length(k)]))
+    return tape
+
+
+def read_tape(source):
+    """
+    Read a tape header written by `write_tape`.
+
+    Parameters
+    ----------
+    source : int, str, file or buffer
+        File descriptor, path, binary file object open for reading or buffer
+        (e.g. `mmap`) to read header from its current position (start for a
+        path or buffer).
+
+    Returns
+    -------
+    Tape
+        Tape described by header, for regenerating chunks.
+
+    Raises
+    ------
+        ValueError: Source does not start with a tape header.
+    """
+    if isinstance(source, int):
+        data = os.read(source, HEADER_SIZE)
+    elif isinstance(source, str):
+        with open(source, 'rb') as f:
+            data = f.read(HEADER_SIZE)
+    elif hasattr(source, 'read'):
+        data = source.read(HEADER_SIZE)
+    else:
+        data = bytes(memoryview(source).cast('B')[:HEADER_SIZE])
+    return Tape.from_bytes(data)
@@ -1,10 +1,19 @@
+import ctypes
+import pickle
 import numpy as np
-from revrng.numpy_wrapper import ReversibleRandomState
+from revrng.numpy_wrapper import (
+    ReversibleRandomState, ReversibleRandomStateBatch, independent_streams,
+    states_from_seeds)
+try:
+    from revrng.bit_generator import ReversibleMT19937
+except ImportError:
+    ReversibleMT19937 = None
 
 
 SEED = 12345
 N_ITER = 100
 IN_RANGE_SAMPLES = 10000
+KEY_LENGTH_SAMPLES = 1000
 SHAPES = [2, (1,), (5, 4), (3, 2, 1, 2)]
 
 
@@ -114,6 +123,78 @@ def test_reversibility_standard_normal():
         )
 
 
+def test_multivariate_normal_matches_transformed_and_reverses():
+    mean = np.array([1., -2., 0.5])
+    chol = np.array([[2., 0., 0.], [0.5, 1., 0.], [-1., 0.25, 3.]])
+    for n in [None, 1, 7, 2 * KEY_LENGTH_SAMPLES + 1]:
+        state = ReversibleRandomState(SEED)
+        normals = ReversibleRandomState(SEED).standard_normal(
+            (3,) if n is None else (n, 3))
+        samples = state.multivariate_normal(mean, chol, n)
+        assert np.allclose(samples, mean + normals @ chol.T), (
+            'Multivariate normal samples do not match transformed normals'
+        )
+        # entries above diagonal are not used
+        out = np.empty_like(samples)
+        state.reverse()
+        returned = state.multivariate_normal(
+            mean, chol + np.triu(np.ones((3, 3)), 1), out=out)
+        assert returned is out and np.all(out == samples), (
+            'Reversed multivariate normal samples do not match forward'
+        )
+
+
+def test_carried_normals_use_pairs_and_reverse():
+    for thread_safe in [True, False]:
+        state = ReversibleRandomState(
+            SEED, thread_safe=thread_safe, carry_normals=True)
+        pairs = ReversibleRandomState(SEED).standard_normal(2 * N_ITER)
+        samples = [state.standard_normal() for i in range(N_ITER)]
+        samples += list(state.standard_normal(N_ITER - 1))
+        samples.append(state.standard_normal())
+        assert np.all(np.array(samples) == pairs), (
+            'Carried normal samples do not match sequence of pairs'
+        )
+        # reverse while holding spare normal, which is pickled with state
+        last = state.standard_normal(3)
+        assert state.get_state()['spare_normal'] is not None, (
+            'Spare normal not held after odd sized draw'
+        )
+        state = pickle.loads(pickle.dumps(state))
+        state.reverse()
+        assert np.all(state.standard_normal(3) == last), (
+            'Reversed carried normal samples do not match forward'
+        )
+        reversed_samples = [state.standard_normal()]
+        reversed_samples += list(state.standard_normal(N_ITER - 1)[::-1])
+        reversed_samples += [state.standard_normal() for i in range(N_ITER)]
+        assert np.all(np.array(reversed_samples) == pairs[::-1]), (
+            'Reversed carried normal samples do not match forward samples'
+        )
+
+
+def test_reversibility_standard_normal_inverse_cdf():
+    state = ReversibleRandomState(SEED)
+    samples_fwd = []
+    for i in range(N_ITER):
+        samples_fwd.append(state.standard_normal(i + 1, 'inverse_cdf'))
+        samples_fwd.append(state.standard_normal(method='inverse_cdf'))
+    state.reverse()
+    for i in range(N_ITER - 1, -1, -1):
+        sample_fwd = samples_fwd.pop(-1)
+        sample_bwd = state.standard_normal(method='inverse_cdf')
+        assert sample_fwd == sample_bwd, (
+            'Incorrect reversed standard_normal samples, expected {0} got {1}'
+            .format(sample_fwd, sample_bwd)
+        )
+        sample_fwd = samples_fwd.pop(-1)
+        sample_bwd = state.standard_normal(i + 1, 'inverse_cdf')
+        assert np.all(sample_fwd == sample_bwd), (
+            'Incorrect reversed standard_normal samples, expected {0} got {1}'
+            .format(sample_fwd, sample_bwd)
+        )
+
+
 def test_reversibility_mixed():
     state = ReversibleRandomState(SEED)
     samples_fwd = []
@@ -158,3 +239,735 @@ def test_standard_uniform_in_range():
     assert np.all(samples >= 0.) and np.all(samples < 1.), (
         'standard_uniform samples out of range [0., 1.)'
     )
+
+
+def test_array_matches_scalar_random_int32():
+    state_array = ReversibleRandomState(SEED)
+    state_scalar = ReversibleRandomState(SEED)
+    for reverse in [False, True]:
+        if reverse:
+            state_array.reverse()
+            state_scalar.reverse()
+        # span several twists so runs cross key boundaries
+        samples_array = state_array.random_int32(3 * IN_RANGE_SAMPLES // 7)
+        samples_scalar = np.array([
+            state_scalar.random_int32() for i in range(samples_array.size)
+        ])
+        if reverse:
+            samples_scalar = samples_scalar[::-1]
+        assert np.all(samples_array == samples_scalar), (
+            'random_int32 array samples do not match scalar samples'
+        )
+
+
+def test_array_matches_scalar_standard_uniform():
+    state_array = ReversibleRandomState(SEED)
+    state_scalar = ReversibleRandomState(SEED)
+    for reverse in [False, True]:
+        if reverse:
+            state_array.reverse()
+            state_scalar.reverse()
+        samples_array = state_array.standard_uniform(3 * IN_RANGE_SAMPLES // 7)
+        samples_scalar = np.array([
+            state_scalar.standard_uniform() for i in range(samples_array.size)
+        ])
+        if reverse:
+            samples_scalar = samples_scalar[::-1]
+        assert np.all(samples_array == samples_scalar), (
+            'standard_uniform array samples do not match scalar samples'
+        )
+
+
+def test_standard_normal_moments():
+    state = ReversibleRandomState(SEED)
+    samples = state.standard_normal(100 * IN_RANGE_SAMPLES)
+    # standard errors of mean and variance estimates are 1e-3 and 1.4e-3
+    assert abs(samples.mean()) < 5e-3, (
+        'standard_normal sample mean {0} far from 0'.format(samples.mean())
+    )
+    assert abs(samples.var() - 1.) < 7e-3, (
+        'standard_normal sample variance {0} far from 1'.format(samples.var())
+    )
+    samples = state.standard_normal(100 * IN_RANGE_SAMPLES, 'inverse_cdf')
+    assert abs(samples.mean()) < 5e-3, (
+        'inverse_cdf sample mean {0} far from 0'.format(samples.mean())
+    )
+    assert abs(samples.var() - 1.) < 7e-3, (
+        'inverse_cdf sample variance {0} far from 1'.format(samples.var())
+    )
+
+
+def states_equal(state_1, state_2):
+    dict_1, dict_2 = state_1.get_state(), state_2.get_state()
+    return all(np.all(dict_1[k] == dict_2[k]) for k in dict_1)
+
+
+def test_jump_matches_discarded_draws():
+    for reverse in [False, True]:
+        for n in [0, 1, 623, 624, 625, 5 * 624 + 17, 30001]:
+            state_jump = ReversibleRandomState(SEED)
+            state_draw = ReversibleRandomState(SEED)
+            state_jump.random_int32(1000)
+            state_draw.random_int32(1000)
+            if reverse:
+                state_jump.reverse()
+                state_draw.reverse()
+            state_jump.jump(n)
+            state_draw.random_int32(n)
+            assert states_equal(state_jump, state_draw), (
+                'State after jump by {0} does not match discarded draws'
+                .format(n)
+            )
+
+
+def test_jump_rewinds_draws():
+    state = ReversibleRandomState(SEED)
+    samples_fwd = state.random_int32(30001)
+    state.jump(-30001)
+    samples_rewound = state.random_int32(30001)
+    assert np.all(samples_fwd == samples_rewound), (
+        'Samples after jump by -30001 do not match previous samples'
+    )
+
+
+def test_jump_large_inverse_and_composition():
+    # large enough to use polynomial jump rather than repeated twists
+    n_1, n_2 = 10**7 * 624 + 5, 3 * 10**8 + 1
+    state_1 = ReversibleRandomState(SEED)
+    state_2 = ReversibleRandomState(SEED)
+    state_1.jump(n_1)
+    state_1.jump(n_2)
+    state_2.jump(n_1 + n_2)
+    assert states_equal(state_1, state_2), (
+        'Composed jumps do not match single jump'
+    )
+    state_1.jump(-(n_1 + n_2))
+    samples_jumped = state_1.random_int32(1000)
+    samples_initial = ReversibleRandomState(SEED).random_int32(1000)
+    assert np.all(samples_jumped == samples_initial), (
+        'Samples after jump forward and back do not match initial samples'
+    )
+
+
+def test_independent_streams_match_jumped_states():
+    # small and large separations use repeated twists and polynomial jumps
+    for stream_twists in [3, 20000]:
+        streams = independent_streams(SEED, 4, stream_twists)
+        for i, stream in enumerate(streams):
+            state = ReversibleRandomState(SEED)
+            state.jump(i * stream_twists * 624)
+            assert states_equal(stream, state), (
+                'Stream {0} state does not match jumped state'.format(i)
+            )
+
+
+def test_parallel_fill_matches_serial():
+    for reverse in [False, True]:
+        for method, args in [
+                ('random_int32', ()), ('random_int32', (None, np.uint32)),
+                ('random_int64', ()), ('random_integer', (7,)),
+                ('bernoulli_masks', (0.3,)), ('standard_uniform', ()),
+                ('standard_normal', ('box_muller',)),
+                ('standard_normal', ('inverse_cdf',))]:
+            state_serial = ReversibleRandomState(SEED)
+            state_parallel = ReversibleRandomState(
+                SEED, n_threads=4, parallel_threshold=1000)
+            if reverse:
+                state_serial.reverse()
+                state_parallel.reverse()
+            # odd size so final normal value is from a discarded pair
+            if method in ('random_integer', 'bernoulli_masks'):
+                args, shape = args + (30001,), ()
+            else:
+                shape = (30001,)
+            samples_serial = getattr(state_serial, method)(*(shape + args))
+            samples_parallel = getattr(state_parallel, method)(
+                *(shape + args))
+            assert np.all(samples_serial == samples_parallel), (
+                'Parallel {0} samples do not match serial'.format(method)
+            )
+            assert states_equal(state_serial, state_parallel), (
+                'State after parallel {0} does not match serial'
+                .format(method)
+            )
+
+
+def test_parallel_fill_past_initial_key_with_caches():
+    state_plain = ReversibleRandomState(SEED)
+    state_parallel = ReversibleRandomState(
+        SEED, n_threads=4, parallel_threshold=1000, checkpoint_memory=2**16,
+        lookahead=True)
+    state_plain.random_int32(3000)
+    state_parallel.random_int32(3000)
+    state_parallel.prepare_block()
+    # reverse fill passes before initial key in one of the chunks
+    for n in [30000, 40000]:
+        state_plain.reverse()
+        state_parallel.reverse()
+        assert np.all(
+            state_plain.random_int32(n) == state_parallel.random_int32(n)), (
+            'Parallel samples with caches do not match plain samples'
+        )
+    state_parallel.prepare_block()
+    assert np.all(state_plain.random_int32(10000) ==
+                  state_parallel.random_int32(10000)), (
+        'Samples after parallel fill past initial key do not match'
+    )
+
+
+def test_out_matches_new_array():
+    for method, dtype in [
+            ('random_int32', np.uint64), ('random_int32', np.uint32),
+            ('standard_uniform', np.float64), ('standard_normal', np.float64)]:
+        for reverse in [False, True]:
+            state_new = ReversibleRandomState(SEED)
+            state_out = ReversibleRandomState(SEED)
+            if reverse:
+                state_new.reverse()
+                state_out.reverse()
+            samples_new = getattr(state_new, method)((5, 7))
+            out = np.empty((5, 14), dtype)
+            # contiguous out, strided out and memoryview of contiguous out
+            for target in [out[:, :7].copy(), out[:, ::2], memoryview(
+                    np.empty((5, 7), dtype))]:
+                state = ReversibleRandomState(SEED)
+                if reverse:
+                    state.reverse()
+                returned = getattr(state, method)(out=target)
+                assert returned is target, (
+                    '{0} did not return out'.format(method)
+                )
+                assert np.all(np.asarray(target) == samples_new), (
+                    '{0} out samples do not match new array samples'
+                    .format(method)
+                )
+            getattr(state_out, method)(out=out[:, :7])
+            assert states_equal(state_new, state_out), (
+                'State after {0} with out does not match'.format(method)
+            )
+
+
+def test_float32_dtype_and_range():
+    state = ReversibleRandomState(SEED)
+    samples = state.standard_uniform(IN_RANGE_SAMPLES, dtype=np.float32)
+    assert samples.dtype == np.float32, (
+        'standard_uniform dtype mismatch: should be float32 actually {0}'
+        .format(samples.dtype)
+    )
+    assert np.all(samples >= 0.) and np.all(samples < 1.), (
+        'float32 standard_uniform samples out of range [0., 1.)'
+    )
+    samples = state.standard_normal(IN_RANGE_SAMPLES, dtype=np.float32)
+    assert samples.dtype == np.float32, (
+        'standard_normal dtype mismatch: should be float32 actually {0}'
+        .format(samples.dtype)
+    )
+    assert np.all(np.isfinite(samples)), (
+        'float32 standard_normal samples not all finite'
+    )
+
+
+def test_reversibility_float32():
+    state = ReversibleRandomState(SEED)
+    samples_fwd = []
+    for i in range(N_ITER):
+        samples_fwd.append(state.standard_uniform(i + 1, dtype=np.float32))
+        samples_fwd.append(state.standard_normal(i + 1, dtype=np.float32))
+    state.reverse()
+    for i in range(N_ITER - 1, -1, -1):
+        sample_fwd = samples_fwd.pop(-1)
+        sample_bwd = state.standard_normal(i + 1, dtype=np.float32)
+        assert np.all(sample_fwd == sample_bwd), (
+            'Incorrect reversed float32 standard_normal samples'
+        )
+        sample_fwd = samples_fwd.pop(-1)
+        sample_bwd = state.standard_uniform(i + 1, dtype=np.float32)
+        assert np.all(sample_fwd == sample_bwd), (
+            'Incorrect reversed float32 standard_uniform samples'
+        )
+
+
+def test_array_matches_scalar_float32_standard_uniform():
+    state_array = ReversibleRandomState(SEED)
+    state_scalar = ReversibleRandomState(SEED)
+    samples_array = state_array.standard_uniform(
+        3 * IN_RANGE_SAMPLES // 7, dtype=np.float32)
+    samples_scalar = np.array([
+        state_scalar.standard_uniform(dtype=np.float32)
+        for i in range(samples_array.size)
+    ], dtype=np.float32)
+    assert np.all(samples_array == samples_scalar), (
+        'float32 standard_uniform array samples do not match scalar samples'
+    )
+
+
+def test_uint32_dtype_matches_uint64():
+    state_32 = ReversibleRandomState(SEED)
+    state_64 = ReversibleRandomState(SEED)
+    samples_32 = state_32.random_int32(IN_RANGE_SAMPLES, dtype=np.uint32)
+    samples_64 = state_64.random_int32(IN_RANGE_SAMPLES)
+    assert samples_32.dtype == np.uint32, (
+        'random_int32 dtype mismatch: should be uint32 actually {0}'
+        .format(samples_32.dtype)
+    )
+    assert np.all(samples_32 == samples_64), (
+        'uint32 random_int32 samples do not match uint64 samples'
+    )
+    assert states_equal(state_32, state_64), (
+        'State after uint32 random_int32 does not match uint64'
+    )
+
+
+def test_reversibility_random_int64():
+    state = ReversibleRandomState(SEED)
+    samples_fwd = []
+    for i in range(N_ITER):
+        samples_fwd.append(state.random_int64(i + 1))
+        samples_fwd.append(state.random_int32(i + 1))
+    state.reverse()
+    for i in range(N_ITER - 1, -1, -1):
+        sample_fwd = samples_fwd.pop(-1)
+        sample_bwd = state.random_int32(i + 1)
+        assert np.all(sample_fwd == sample_bwd), (
+            'Incorrect reversed random_int32 samples'
+        )
+        sample_fwd = samples_fwd.pop(-1)
+        sample_bwd = state.random_int64(i + 1)
+        assert np.all(sample_fwd == sample_bwd), (
+            'Incorrect reversed random_int64 samples'
+        )
+
+
+def test_array_matches_scalar_random_int64():
+    state_array = ReversibleRandomState(SEED)
+    state_scalar = ReversibleRandomState(SEED)
+    state_int32 = ReversibleRandomState(SEED)
+    samples_array = state_array.random_int64(3 * IN_RANGE_SAMPLES // 7)
+    samples_scalar = np.array([
+        state_scalar.random_int64() for i in range(samples_array.size)
+    ], dtype=np.uint64)
+    assert samples_array.dtype == np.uint64, (
+        'random_int64 dtype mismatch: should be uint64 actually {0}'
+        .format(samples_array.dtype)
+    )
+    assert np.all(samples_array == samples_scalar), (
+        'random_int64 array samples do not match scalar samples'
+    )
+    words = state_int32.random_int32(2 * samples_array.size)
+    assert np.all(samples_array == (words[::2] << 32 | words[1::2])), (
+        'random_int64 samples do not pack consecutive random_int32 samples'
+    )
+
+
+def test_random_integer_in_range_and_reversible():
+    for n in [1, 2, 7, 1000, 2**32]:
+        state = ReversibleRandomState(SEED)
+        samples = state.random_integer(n, IN_RANGE_SAMPLES)
+        assert np.all(samples < n), (
+            'random_integer samples out of range [0, {0})'.format(n)
+        )
+        state.reverse()
+        assert np.all(state.random_integer(n, IN_RANGE_SAMPLES) == samples), (
+            'Incorrect reversed random_integer samples'
+        )
+    state = ReversibleRandomState(SEED)
+    counts = np.bincount(state.random_integer(7, 70000), minlength=7)
+    assert np.all(np.abs(counts - 10000) < 500), (
+        'random_integer value counts {0} not close to uniform'.format(counts)
+    )
+
+
+def test_array_matches_scalar_random_integer():
+    state_array = ReversibleRandomState(SEED)
+    state_scalar = ReversibleRandomState(SEED)
+    samples_array = state_array.random_integer(1000, 3 * IN_RANGE_SAMPLES // 7)
+    samples_scalar = np.array([
+        state_scalar.random_integer(1000) for i in range(samples_array.size)
+    ])
+    assert np.all(samples_array == samples_scalar), (
+        'random_integer array samples do not match scalar samples'
+    )
+
+
+def test_bernoulli_masks_probability_and_reversible():
+    for p in [0., 0.5, 0.25, 0.3, 1.]:
+        state = ReversibleRandomState(SEED)
+        masks = state.bernoulli_masks(p, IN_RANGE_SAMPLES)
+        bits = (masks[:, None] >> np.arange(32, dtype=np.uint32)) & 1
+        assert abs(bits.mean() - p) < 0.01, (
+            'bernoulli_masks bit mean {0} not close to {1}'
+            .format(bits.mean(), p)
+        )
+        state.reverse()
+        assert np.all(state.bernoulli_masks(p, IN_RANGE_SAMPLES) == masks), (
+            'Incorrect reversed bernoulli_masks samples'
+        )
+
+
+def test_bernoulli_matches_masks():
+    state_masks = ReversibleRandomState(SEED)
+    state_bool = ReversibleRandomState(SEED)
+    masks = state_masks.bernoulli_masks(0.3, 4)
+    values = state_bool.bernoulli(0.3, (10, 10))
+    bits = (masks[:, None] >> np.arange(32, dtype=np.uint32)) & 1
+    assert values.dtype == np.bool_, (
+        'bernoulli dtype mismatch: should be bool actually {0}'
+        .format(values.dtype)
+    )
+    assert np.all(values.ravel() == bits.ravel()[:100].astype(np.bool_)), (
+        'bernoulli values do not match unpacked bernoulli_masks bits'
+    )
+    assert states_equal(state_masks, state_bool), (
+        'State after bernoulli does not match bernoulli_masks'
+    )
+
+
+def test_thread_unsafe_matches_thread_safe():
+    state_safe = ReversibleRandomState(SEED)
+    state_unsafe = ReversibleRandomState(SEED, thread_safe=False)
+    for reverse in [False, True]:
+        if reverse:
+            state_safe.reverse()
+            state_unsafe.reverse()
+        for method, args in [
+                ('random_int32', ()), ('random_int64', ()),
+                ('standard_uniform', ()), ('standard_normal', ()),
+                ('standard_normal', ('inverse_cdf',))]:
+            for shape in [None, (5, 3)]:
+                sample_safe = getattr(state_safe, method)(shape, *args)
+                sample_unsafe = getattr(state_unsafe, method)(shape, *args)
+                assert np.all(sample_safe == sample_unsafe), (
+                    'Thread unsafe {0} samples do not match thread safe'
+                    .format(method)
+                )
+                assert type(sample_safe) == type(sample_unsafe), (
+                    'Thread unsafe {0} type mismatch: should be {1} actually '
+                    '{2}'.format(method, type(sample_safe),
+                                 type(sample_unsafe))
+                )
+        assert states_equal(state_safe, state_unsafe), (
+            'State of thread unsafe generator does not match thread safe'
+        )
+
+
+def test_capsule_interface_matches_methods():
+    state_capsule = ReversibleRandomState(SEED)
+    state_method = ReversibleRandomState(SEED)
+    capsule = state_capsule.capsule
+    get_pointer = ctypes.pythonapi.PyCapsule_GetPointer
+    get_pointer.restype = ctypes.c_void_p
+    get_pointer.argtypes = [ctypes.py_object, ctypes.c_char_p]
+    pointer = get_pointer(capsule, b'revrng.rng_interface')
+    ulong_func = ctypes.CFUNCTYPE(ctypes.c_ulong, ctypes.c_void_p)
+    uint64_func = ctypes.CFUNCTYPE(ctypes.c_uint64, ctypes.c_void_p)
+    double_func = ctypes.CFUNCTYPE(ctypes.c_double, ctypes.c_void_p)
+    void_func = ctypes.CFUNCTYPE(None, ctypes.c_void_p)
+    # leading fields of rng_interface in declaration order
+    interface = ctypes.cast(pointer, ctypes.POINTER(ctypes.c_void_p * 10))[0]
+    rng = interface[0]
+    random_int32 = ulong_func(interface[1])
+    random_int64 = uint64_func(interface[2])
+    random_uniform = double_func(interface[4])
+    reverse = void_func(interface[8])
+    samples_capsule = [random_int32(rng), random_int64(rng),
+                       random_uniform(rng)]
+    samples_method = [state_method.random_int32(),
+                      state_method.random_int64(),
+                      state_method.standard_uniform()]
+    assert samples_capsule == samples_method, (
+        'Capsule interface samples do not match method samples'
+    )
+    reverse(rng)
+    assert random_uniform(rng) == samples_capsule[-1], (
+        'Capsule interface reverse did not reverse generator'
+    )
+
+
+def test_bit_generator_matches_methods_and_reverses():
+    if ReversibleMT19937 is None:
+        return
+    state = ReversibleRandomState(SEED)
+    gen = np.random.Generator(ReversibleMT19937(SEED))
+    samples_gen = gen.random(1001)
+    samples_state = state.standard_uniform(1001)
+    assert np.all(samples_gen == samples_state), (
+        'Generator.random samples do not match standard_uniform samples'
+    )
+    samples_gen = gen.integers(0, 2**64, 11, dtype=np.uint64)
+    samples_state = state.random_int64(11)
+    assert np.all(samples_gen == samples_state), (
+        'Generator.integers full range samples do not match random_int64'
+    )
+    gen.bit_generator.reverse()
+    assert np.all(gen.integers(0, 2**64, 11, dtype=np.uint64) ==
+                  samples_gen[::-1]), (
+        'Incorrect reversed Generator.integers samples'
+    )
+    state_dict = gen.bit_generator.state
+    samples_gen = gen.random(10)
+    gen.bit_generator.state = state_dict
+    assert np.all(gen.random(10) == samples_gen), (
+        'Generator samples after restoring state do not match'
+    )
+    # positions valid in only one direction rejected for the other
+    for reversed, pos in [(1, 624), (0, -1), (1, -2), (0, 625)]:
+        invalid = {'bit_generator': state_dict['bit_generator'],
+                   'state': dict(state_dict['state'], pos=pos,
+                                 reversed=reversed)}
+        try:
+            gen.bit_generator.state = invalid
+        except ValueError:
+            continue
+        assert False, (
+            'State with position {0} accepted with reversed {1}'
+            .format(pos, reversed)
+        )
+
+
+def test_set_state_restores_draws():
+    for reverse in [False, True]:
+        state = ReversibleRandomState(SEED)
+        if reverse:
+            state.reverse()
+        state.standard_uniform(1000)
+        saved = state.get_state()
+        samples = state.standard_normal(777)
+        state.set_state(saved)
+        assert np.all(state.standard_normal(777) == samples), (
+            'Samples after set_state do not match samples after get_state'
+        )
+        other = ReversibleRandomState(SEED + 1)
+        other.set_state(saved)
+        other.standard_normal(777)
+        assert states_equal(state, other), (
+            'State after set_state and sampling does not match'
+        )
+
+
+def test_get_state_view_is_read_only_and_current():
+    state = ReversibleRandomState(SEED)
+    key_view = state.get_state(copy=False)['key']
+    assert not key_view.flags.writeable, 'Key view should be read-only'
+    state.random_int32(KEY_LENGTH_SAMPLES)
+    assert np.all(key_view == state.get_state()['key']), (
+        'Key view does not reflect current generator key'
+    )
+
+
+def test_pickle_round_trip():
+    state = ReversibleRandomState(SEED, thread_safe=False)
+    state.standard_uniform(1001)
+    state.reverse()
+    unpickled = pickle.loads(pickle.dumps(state))
+    assert states_equal(state, unpickled), (
+        'State of unpickled generator does not match'
+    )
+    assert np.all(state.random_int32(100) == unpickled.random_int32(100)), (
+        'Samples of unpickled generator do not match'
+    )
+
+
+def test_checkpoints_do_not_change_samples():
+    state_plain = ReversibleRandomState(SEED)
+    state_cached = ReversibleRandomState(SEED, checkpoint_memory=2**16)
+    for state in [state_plain, state_cached]:
+        state.jump(2000 * 624)
+    for i in range(20):
+        n = (i + 1) * 1000
+        if i % 3 == 2:
+            state_plain.reverse()
+            state_cached.reverse()
+        samples_plain = state_plain.random_int32(n)
+        samples_cached = state_cached.random_int32(n)
+        assert np.all(samples_plain == samples_cached), (
+            'Samples with checkpoints do not match samples without'
+        )
+        assert states_equal(state_plain, state_cached), (
+            'State with checkpoints does not match state without'
+        )
+
+
+def test_philox_engine_reverses_jumps_and_pickles():
+    state = ReversibleRandomState(SEED, engine='philox')
+    assert state.get_state()['engine'] == 'philox'
+    values = state.random_int32(10 * KEY_LENGTH_SAMPLES)
+    assert not np.all(
+        values == ReversibleRandomState(SEED).random_int32(values.size)), (
+        'Philox values match Mersenne-Twister values'
+    )
+    state.reverse()
+    assert np.all(state.random_int32(values.size) == values), (
+        'Reversed Philox values do not match forward values'
+    )
+    for k in [0, 1, 624, 5000]:
+        jumped = ReversibleRandomState(SEED, engine='philox')
+        jumped.jump(k)
+        assert jumped.random_int32() == values[k], (
+            'Philox value after jump {0} does not match drawn value'
+            .format(k)
+        )
+        assert jumped.value_at(k) == values[k], (
+            'Philox value at position {0} does not match drawn value'
+            .format(k)
+        )
+    unpickled = pickle.loads(pickle.dumps(jumped))
+    assert states_equal(unpickled, jumped), (
+        'Unpickled Philox state does not match original'
+    )
+    streams = independent_streams(SEED, 3, 10, engine='philox')
+    assert streams[2].random_int32() == jumped.value_at(20 * 624), (
+        'Philox stream does not start at stream separation'
+    )
+
+
+def test_value_at_matches_drawn_values():
+    for checkpoint_memory in [0, 2**16]:
+        state = ReversibleRandomState(
+            SEED, checkpoint_memory=checkpoint_memory)
+        values = ReversibleRandomState(SEED).random_int32(
+            20 * KEY_LENGTH_SAMPLES, dtype=np.uint32)
+        state.random_int32(123)
+        state_before = state.get_state()
+        for k in [5000, 0, 623, 624, 19999, 1000, 17]:
+            assert state.value_at(k) == values[k], (
+                'Value at position {0} does not match drawn value'.format(k)
+            )
+        assert np.all(state.fill_range(3000, 7000) == values[3000:7000]), (
+            'Values in range do not match drawn values'
+        )
+        out = np.empty(100, np.uint64)
+        state.fill_range(100, 200, out=out)
+        assert np.all(out == values[100:200]), (
+            'Values in range generated in to out do not match drawn values'
+        )
+        state_after = state.get_state()
+        assert all(np.all(state_before[k] == state_after[k])
+                   for k in state_before), (
+            'Generator state changed by value_at / fill_range'
+        )
+
+
+def test_value_at_after_moving_before_initial_key():
+    values = ReversibleRandomState(SEED).random_int32(
+        6 * KEY_LENGTH_SAMPLES, dtype=np.uint32)
+    state = ReversibleRandomState(SEED, checkpoint_memory=2**16)
+    # keys saved after reversing past initial key depend on path taken so
+    # must not be used to find values of stream from seed
+    state.reverse()
+    state.random_int32(3 * KEY_LENGTH_SAMPLES)
+    state.reverse()
+    state.random_int32(10 * KEY_LENGTH_SAMPLES)
+    for k in range(0, values.size, 7):
+        assert state.value_at(k) == values[k], (
+            'Value at position {0} does not match drawn value'.format(k)
+        )
+    assert np.all(state.fill_range(0, values.size) == values), (
+        'Values in range do not match drawn values'
+    )
+
+
+def test_lookahead_does_not_change_samples():
+    state_plain = ReversibleRandomState(SEED)
+    state_ahead = ReversibleRandomState(SEED, lookahead=True)
+    for i in range(20):
+        n = (i + 1) * 100
+        # reverse part way through blocks and back past initial key
+        if i % 4 == 3:
+            state_plain.reverse()
+            state_ahead.reverse()
+        for j in range(5):
+            state_ahead.prepare_block()
+            samples_plain = state_plain.random_int32(n)
+            samples_ahead = state_ahead.random_int32(n)
+            assert np.all(samples_plain == samples_ahead), (
+                'Samples with lookahead do not match samples without'
+            )
+    assert states_equal(state_plain, state_ahead), (
+        'State with lookahead does not match state without'
+    )
+
+
+def test_lookahead_prepared_once_before_initial_key():
+    state_plain = ReversibleRandomState(SEED)
+    state_ahead = ReversibleRandomState(SEED, lookahead=True)
+    state_plain.random_int32(1000)
+    state_ahead.random_int32(1000)
+    # stale prepared key must not be used after passing before initial key
+    state_ahead.prepare_block()
+    for n in [3000, 5 * KEY_LENGTH_SAMPLES]:
+        state_plain.reverse()
+        state_ahead.reverse()
+        assert np.all(
+            state_plain.random_int32(n) == state_ahead.random_int32(n)), (
+            'Samples with lookahead do not match samples without'
+        )
+
+
+def test_states_from_seeds_match_seeded_states():
+    seeds = [0, 1, SEED, 2**32 - 1] + list(range(100, 113))
+    states = states_from_seeds(seeds, thread_safe=False)
+    assert len(states) == len(seeds), (
+        'Number of states {0} does not match number of seeds {1}'
+        .format(len(states), len(seeds))
+    )
+    for seed, state in zip(seeds, states):
+        assert states_equal(state, ReversibleRandomState(seed)), (
+            'State from seed {0} does not match seeded state'.format(seed)
+        )
+
+
+def test_batch_matches_individual_states():
+    seeds = [SEED + 3 * i for i in range(37)]
+    batch = ReversibleRandomStateBatch(seeds)
+    states = [ReversibleRandomState(seed) for seed in seeds]
+    methods = [
+        ('random_int32', ()), ('standard_uniform', ()),
+        ('standard_normal', (None, 'inverse_cdf'))]
+    for i in range(3 * KEY_LENGTH_SAMPLES):
+        # reverse part way through so reversal crosses key twists
+        if i == 2 * KEY_LENGTH_SAMPLES:
+            batch.reverse()
+            for state in states:
+                state.reverse()
+        method, args = methods[i % 3]
+        samples_batch = getattr(batch, method)()
+        samples_states = [getattr(state, method)(*args) for state in states]
+        assert np.all(samples_batch == samples_states), (
+            'Batch {0} samples do not match individual states'.format(method)
+        )
+    for s, state in enumerate(states):
+        assert states_equal(batch.get_stream(s), state), (
+            'Batch stream {0} state does not match individual state'
+            .format(s)
+        )
+
+
+def test_counters_count_draws_and_reversals():
+    state = ReversibleRandomState(SEED, n_threads=4, parallel_threshold=1000)
+    try:
+        state.counters
+    except RuntimeError:
+        # extension built without counters
+        return
+    state.random_int32(10 * KEY_LENGTH_SAMPLES)
+    state.standard_uniform(5000)
+    state.reverse()
+    state.standard_uniform(5000)
+    state.jump(10 ** 6)
+    state.random_int32()
+    counters = state.counters
+    expected = {
+        'forward_words': 10 * KEY_LENGTH_SAMPLES + 2 * 5000,
+        'reverse_words': 2 * 5000 + 1, 'reversals': 1
+    }
+    for name, value in expected.items():
+        assert counters[name] == value, (
+            'Counter {0} is {1} not {2}'.format(name, counters[name], value)
+        )
+    assert counters['twists'] >= (10 * KEY_LENGTH_SAMPLES) // 624, (
+        'Too few twists counted'
+    )
+    state.reset_counters()
+    assert all(value == 0 for value in state.counters.values()), (
+        'Counters not zero after reset'
+    )
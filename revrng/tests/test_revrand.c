@@ -0,0 +1,423 @@
+/*
+ * Tests of the standalone C library interface in revrand.h.
+ *
+ * Author: Matt Graham (matt-graham.github.io)
+ *
+ * Built and run as the test_revrand target of the CMake build. Exits with a
+ * non-zero status if any test fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "revrand.h"
+
+#define SEED 12345UL
+#define N_VALUES 5000
+
+static int n_failures = 0;
+
+#define CHECK(condition, message) \
+    do { \
+        if (!(condition)) { \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, message); \
+            n_failures++; \
+            return; \
+        } \
+    } while (0)
+
+/* Outputs for seed 5489 of the reference MT-19937 implementation. */
+static void test_matches_reference_outputs(void)
+{
+    rng_state state;
+    unsigned long value = 0;
+    int i;
+    revrand_init_state(5489UL, &state);
+    CHECK(revrand_random_int32(&state) == 3499211612UL,
+          "First value does not match reference");
+    for (i = 1; i < 10000; i++) {
+        value = revrand_random_int32(&state);
+    }
+    CHECK(value == 4123659995UL, "10000th value does not match reference");
+}
+
+static void test_reversibility_random_int32(void)
+{
+    rng_state state;
+    static unsigned long values[N_VALUES];
+    int i;
+    revrand_init_state(SEED, &state);
+    for (i = 0; i < N_VALUES; i++) {
+        values[i] = revrand_random_int32(&state);
+    }
+    revrand_reverse(&state);
+    for (i = N_VALUES - 1; i >= 0; i--) {
+        CHECK(revrand_random_int32(&state) == values[i],
+              "Reversed random_int32 does not match forward value");
+    }
+    /* first value drawn from key after first twist */
+    CHECK(state.n_twists == 1 && state.pos == -1,
+          "State not returned to start of stream");
+}
+
+static void test_reversibility_arrays(void)
+{
+    rng_state state;
+    static double forward[N_VALUES], reversed[N_VALUES];
+    int i, r;
+    void (*fills[3])(rng_state*, double*, size_t) = {
+        revrand_random_uniform_array, revrand_random_normal_array,
+        revrand_random_normal_icdf_array};
+    for (r = 0; r < 3; r++) {
+        revrand_init_state(SEED, &state);
+        revrand_jump(&state, 1000);
+        fills[r](&state, forward, N_VALUES - r);
+        revrand_reverse(&state);
+        fills[r](&state, reversed, N_VALUES - r);
+        for (i = 0; i < N_VALUES - r; i++) {
+            CHECK(forward[i] == reversed[i],
+                  "Reversed array does not match forward array");
+        }
+    }
+}
+
+static void test_array_matches_scalar(void)
+{
+    rng_state scalar_state, array_state;
+    static double values[N_VALUES];
+    static uint64_t values_int64[N_VALUES];
+    int i;
+    revrand_init_state(SEED, &scalar_state);
+    revrand_init_state(SEED, &array_state);
+    revrand_random_uniform_array(&array_state, values, N_VALUES);
+    for (i = 0; i < N_VALUES; i++) {
+        CHECK(revrand_random_uniform(&scalar_state) == values[i],
+              "Array random_uniform does not match scalar");
+    }
+    revrand_random_int64_array(&array_state, values_int64, N_VALUES);
+    for (i = 0; i < N_VALUES; i++) {
+        CHECK(revrand_random_int64(&scalar_state) == values_int64[i],
+              "Array random_int64 does not match scalar");
+    }
+}
+
+static void test_carried_normals(void)
+{
+    rng_state state, pairs_state;
+    static double values[N_VALUES], pairs[N_VALUES], reversed[N_VALUES];
+    size_t sizes[6] = {1, 3, 1, 1, 6, 5}, i, j, n = 0;
+    revrand_init_state(SEED, &state);
+    revrand_init_state(SEED, &pairs_state);
+    state.carry_normals = 1;
+    /* draws of any size take consecutive values of one sequence of pairs */
+    for (i = 0; i < 6; i++) {
+        revrand_random_normal_array(&state, &values[n], sizes[i]);
+        n += sizes[i];
+    }
+    values[n++] = revrand_random_normal(&state);
+    revrand_random_normal_array(&pairs_state, pairs, n);
+    for (j = 0; j < n; j++) {
+        CHECK(values[j] == pairs[j],
+              "Carried normal values do not match sequence of pairs");
+    }
+    CHECK(state.has_spare_normal == 0 && state.n_twists == 1 &&
+          state.pos == pairs_state.pos, "Carried normal pairs not all used");
+    /* reverse while holding a spare and regenerate draws in reverse order */
+    revrand_random_normal_array(&state, &values[n], 3);
+    n += 3;
+    revrand_reverse(&state);
+    for (i = 0; i < 2; i++) {
+        reversed[n - 1] = revrand_random_normal(&state);
+        n--;
+    }
+    revrand_random_normal_array(&state, &reversed[n - 2], 2);
+    n -= 2;
+    for (i = 6; i-- > 0;) {
+        revrand_random_normal_array(&state, &reversed[n - sizes[i]],
+                                    sizes[i]);
+        n -= sizes[i];
+    }
+    for (j = 0; j < 18 + 3; j++) {
+        CHECK(reversed[j] == values[j],
+              "Reversed carried normals do not match forward values");
+    }
+    CHECK(state.has_spare_normal == 0 && state.n_twists == 1 &&
+          state.pos == -1, "State not returned to start of stream");
+}
+
+static void test_multivariate_normal(void)
+{
+    rng_state state, normal_state;
+    static double forward[3 * 1001], reversed[3 * 1001], normals[3 * 1001];
+    const double mean[3] = {1., -2., 0.5};
+    /* upper triangle entries are not read so set to values that would show */
+    const double chol[9] = {2., 99., 99., 0.5, 1., 99., -1., 0.25, 3.};
+    double sum;
+    int v, r, c;
+    revrand_init_state(SEED, &state);
+    revrand_init_state(SEED, &normal_state);
+    revrand_random_multivariate_normal(&state, 3, mean, chol, forward, 1001);
+    revrand_random_normal_array(&normal_state, normals, 3 * 1001);
+    for (v = 0; v < 1001; v++) {
+        for (r = 0; r < 3; r++) {
+            sum = 0.;
+            for (c = 0; c <= r; c++) {
+                sum += chol[r * 3 + c] * normals[v * 3 + c];
+            }
+            CHECK(forward[v * 3 + r] == mean[r] + sum,
+                  "Multivariate normal does not match transformed normals");
+        }
+    }
+    revrand_reverse(&state);
+    revrand_random_multivariate_normal(&state, 3, mean, chol, reversed, 1001);
+    for (v = 0; v < 3 * 1001; v++) {
+        CHECK(forward[v] == reversed[v],
+              "Reversed multivariate normal does not match forward array");
+    }
+    CHECK(state.n_twists == 1 && state.pos == -1,
+          "State not returned to start of stream");
+}
+
+static void test_bernoulli_words_match_consumption(void)
+{
+    rng_state masked, jumped;
+    uint32_t masks[100];
+    const uint64_t ps[] = {0, 1, 1ULL << 31, 3ULL << 30, 12345, 1ULL << 32};
+    int i;
+    for (i = 0; i < 6; i++) {
+        revrand_init_state(SEED, &masked);
+        revrand_init_state(SEED, &jumped);
+        revrand_random_bernoulli_masks(&masked, ps[i], masks, 100);
+        revrand_jump(&jumped, 100LL * revrand_bernoulli_words(ps[i]));
+        CHECK(revrand_random_int32(&masked) == revrand_random_int32(&jumped),
+              "Bernoulli masks do not use bernoulli_words integers each");
+    }
+}
+
+static void test_jump_matches_discarded_draws(void)
+{
+    rng_state jumped, drawn;
+    long long n, i;
+    for (n = 1; n < 100000; n *= 7) {
+        revrand_init_state(SEED, &jumped);
+        revrand_init_state(SEED, &drawn);
+        revrand_jump(&jumped, n);
+        for (i = 0; i < n; i++) {
+            revrand_random_int32(&drawn);
+        }
+        CHECK(revrand_random_int32(&jumped) == revrand_random_int32(&drawn),
+              "Value after jump does not match value after draws");
+    }
+}
+
+/* jumps of more than JUMP_MIN_TWISTS (10000) twists use the jump polynomial */
+static void test_long_jump_matches_discarded_draws(void)
+{
+    rng_state jumped, drawn;
+    const long long n = 7000000LL;
+    unsigned long first, value = 0;
+    long long i;
+    revrand_init_state(SEED, &drawn);
+    first = revrand_random_int32(&drawn);
+    for (i = 1; i <= 2 * n; i++) {
+        if (i == n) {
+            value = revrand_random_int32(&drawn);
+        }
+        else {
+            revrand_random_int32(&drawn);
+        }
+    }
+    revrand_init_state(SEED, &jumped);
+    revrand_jump(&jumped, n);
+    CHECK(revrand_random_int32(&jumped) == value,
+          "Value after long jump does not match value after draws");
+    jumped = drawn;
+    revrand_jump(&jumped, -(n + 1));
+    CHECK(revrand_random_int32(&jumped) == value,
+          "Value after long rewind does not match value after draws");
+    /* long jump in the reverse direction back to the first value */
+    revrand_reverse(&jumped);
+    revrand_jump(&jumped, n);
+    CHECK(revrand_random_int32(&jumped) == first &&
+          jumped.n_twists == 1 && jumped.pos == -1,
+          "Reversed long jump does not match first value drawn");
+}
+
+static void test_value_at_matches_drawn_values(void)
+{
+    rng_state drawn, cursor;
+    rng_checkpoints checkpoints;
+    uint32_t values[N_VALUES], range[100], keys[4 * REVRAND_KEY_LENGTH];
+    long long tags[4];
+    const long long indices[] = {4321, 0, 623, 624, N_VALUES - 1, 1000, 17};
+    int i;
+    revrand_init_state(SEED, &drawn);
+    revrand_random_uint32_array(&drawn, values, N_VALUES);
+    revrand_init_state(SEED, &cursor);
+    checkpoints.keys = keys;
+    checkpoints.tags = tags;
+    checkpoints.capacity = 4;
+    revrand_clear_checkpoints(&checkpoints);
+    cursor.checkpoints = &checkpoints;
+    for (i = 0; i < 7; i++) {
+        CHECK(revrand_value_at(&cursor, indices[i]) == values[indices[i]],
+              "Value at index does not match drawn value");
+    }
+    revrand_init_state(SEED, &drawn);
+    revrand_jump(&drawn, 100000000LL);
+    CHECK(revrand_value_at(&cursor, 100000000LL) ==
+          revrand_random_int32(&drawn),
+          "Value at distant index does not match value after jump");
+    revrand_reverse(&cursor);
+    revrand_fill_range(&cursor, 2000, 2100, range);
+    for (i = 0; i < 100; i++) {
+        CHECK(range[i] == values[2000 + i],
+              "Value in range does not match drawn value");
+    }
+    CHECK(revrand_random_int32(&cursor) == values[1999],
+          "Reversed cursor does not continue before range");
+    revrand_reverse(&cursor);
+    revrand_random_int32(&cursor);
+    CHECK(revrand_random_int32(&cursor) == values[2000],
+          "Cursor does not continue in range after reversing");
+}
+
+static void test_lookahead_matches_computed_blocks(void)
+{
+    rng_state state, computed;
+    rng_lookahead lookahead;
+    int i, step;
+    /* reverses mid-block and moves before initial key and back */
+    const int steps[] = {2 * N_VALUES, -3 * N_VALUES - 17, 3 * N_VALUES, -1000};
+    revrand_init_state(SEED, &state);
+    revrand_init_state(SEED, &computed);
+    revrand_clear_lookahead(&lookahead);
+    state.lookahead = &lookahead;
+    for (step = 0; step < 4; step++) {
+        if ((steps[step] < 0) != (state.reversed != 0)) {
+            revrand_reverse(&state);
+            revrand_reverse(&computed);
+        }
+        for (i = 0; i < abs(steps[step]); i++) {
+            revrand_prepare_block(&state, &lookahead);
+            CHECK(revrand_random_int32(&state) ==
+                  revrand_random_int32(&computed),
+                  "Value with lookahead does not match computed value");
+        }
+        revrand_jump(&state, 123);
+        revrand_jump(&computed, 123);
+    }
+    CHECK(state.n_twists == computed.n_twists && state.pos == computed.pos,
+          "State with lookahead does not match computed state");
+    CHECK(!revrand_counters_enabled() ||
+          (state.counters.lookahead_loads > 0 &&
+           state.counters.twists + state.counters.reverse_twists <
+           computed.counters.twists + computed.counters.reverse_twists),
+          "Lookahead keys not loaded");
+}
+
+/* a key prepared once must not be used after moving before initial key */
+static void test_lookahead_cleared_before_initial_key(void)
+{
+    rng_state state, computed;
+    rng_lookahead lookahead;
+    int i;
+    revrand_init_state(SEED, &state);
+    revrand_init_state(SEED, &computed);
+    revrand_clear_lookahead(&lookahead);
+    state.lookahead = &lookahead;
+    for (i = 0; i < 1000; i++) {
+        revrand_random_int32(&state);
+        revrand_random_int32(&computed);
+    }
+    revrand_prepare_block(&state, &lookahead);
+    revrand_reverse(&state);
+    revrand_reverse(&computed);
+    for (i = 0; i < 3000; i++) {
+        revrand_random_int32(&state);
+        revrand_random_int32(&computed);
+    }
+    revrand_reverse(&state);
+    revrand_reverse(&computed);
+    for (i = 0; i < N_VALUES; i++) {
+        CHECK(revrand_random_int32(&state) ==
+              revrand_random_int32(&computed),
+              "Value after stale lookahead does not match computed value");
+    }
+}
+
+static void test_philox_engine(void)
+{
+    rng_state state, jumped;
+    uint32_t values[N_VALUES];
+    int i;
+    /* Random123 known answer for zero counter and key */
+    revrand_init_philox_state(0, &state);
+    CHECK(revrand_random_int32(&state) == 0x6627e8d5UL &&
+          revrand_random_int32(&state) == 0xe169c58dUL &&
+          revrand_random_int32(&state) == 0xbc57ac4cUL &&
+          revrand_random_int32(&state) == 0x9b00dbd8UL,
+          "Philox values do not match reference outputs");
+    revrand_init_philox_state(SEED, &state);
+    revrand_random_uint32_array(&state, values, N_VALUES);
+    revrand_reverse(&state);
+    for (i = N_VALUES - 1; i >= 0; i--) {
+        CHECK(revrand_random_int32(&state) == values[i],
+              "Reversed Philox value does not match forward value");
+    }
+    for (i = 1; i < N_VALUES; i *= 7) {
+        revrand_init_philox_state(SEED, &jumped);
+        revrand_jump(&jumped, i);
+        CHECK(revrand_random_int32(&jumped) == values[i],
+              "Philox value after jump does not match drawn value");
+    }
+}
+
+static void test_counters(void)
+{
+    rng_state state;
+    rng_counters counters;
+    int i;
+    revrand_init_state(SEED, &state);
+    for (i = 0; i < N_VALUES; i++) {
+        revrand_random_int32(&state);
+    }
+    revrand_reverse(&state);
+    revrand_random_uniform(&state);
+    revrand_get_counters(&state, &counters);
+    if (!revrand_counters_enabled()) {
+        CHECK(counters.forward_words == 0 && counters.twists == 0,
+              "Counters updated when not enabled");
+        return;
+    }
+    CHECK(counters.forward_words == N_VALUES,
+          "Forward words not counted");
+    CHECK(counters.reverse_words == 2 && counters.reversals == 1,
+          "Reverse words or reversals not counted");
+    CHECK(counters.twists == (N_VALUES + REVRAND_KEY_LENGTH - 1) /
+                             REVRAND_KEY_LENGTH,
+          "Twists not counted");
+}
+
+int main(void)
+{
+    test_matches_reference_outputs();
+    test_reversibility_random_int32();
+    test_reversibility_arrays();
+    test_array_matches_scalar();
+    test_carried_normals();
+    test_multivariate_normal();
+    test_bernoulli_words_match_consumption();
+    test_jump_matches_discarded_draws();
+    test_long_jump_matches_discarded_draws();
+    test_value_at_matches_drawn_values();
+    test_lookahead_matches_computed_blocks();
+    test_lookahead_cleared_before_initial_key();
+    test_philox_engine();
+    test_counters();
+    if (n_failures > 0) {
+        fprintf(stderr, "%d test(s) failed\n", n_failures);
+        return EXIT_FAILURE;
+    }
+    printf("All tests passed\n");
+    return EXIT_SUCCESS;
+}
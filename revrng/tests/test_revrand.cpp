@@ -0,0 +1,179 @@
+/*
+ * Tests of the C++ engine interface in revrand.hpp.
+ *
+ * Author: Matt Graham (matt-graham.github.io)
+ *
+ * Built and run as the test_revrand_cpp target of the CMake build, if a C++
+ * compiler is available. Exits with a non-zero status if any test fails.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "revrand.hpp"
+
+#define SEED 12345u
+#define N_VALUES 5000
+
+static int n_failures = 0;
+
+#define CHECK(condition, message) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, \
+                         message); \
+            n_failures++; \
+            return; \
+        } \
+    } while (0)
+
+static void test_matches_std_mt19937()
+{
+    revrand::reversible_mt19937 engine(SEED);
+    std::mt19937 reference(SEED);
+    for (int i = 0; i < N_VALUES; i++) {
+        CHECK(engine() == reference(), "Value does not match std::mt19937");
+    }
+    engine.discard(123457);
+    reference.discard(123457);
+    CHECK(engine() == reference(),
+          "Value after discard does not match std::mt19937");
+}
+
+static void test_matches_c_interface()
+{
+    revrand::reversible_mt19937 engine(SEED);
+    rng_state state;
+    revrand_init_state(SEED, &state);
+    for (int i = 0; i < N_VALUES; i++) {
+        CHECK(engine() == revrand_random_int32(&state),
+              "Value does not match revrand_random_int32");
+    }
+    CHECK(engine.state().pos == state.pos &&
+          engine.state().n_twists == state.n_twists,
+          "State does not match C state");
+}
+
+static void test_reverse_regenerates_values()
+{
+    revrand::reversible_mt19937 engine(SEED);
+    std::vector<std::uint32_t> values(N_VALUES);
+    engine.discard(1000);
+    for (int i = 0; i < N_VALUES; i++) {
+        values[i] = engine();
+    }
+    revrand::reversed_mt19937 reversed = engine.reverse();
+    for (int i = N_VALUES - 1; i >= 0; i--) {
+        CHECK(reversed() == values[i],
+              "Reversed value does not match forward value");
+    }
+    revrand::reversible_mt19937 start(SEED);
+    start.discard(1000);
+    CHECK(reversed.reverse()() == start(),
+          "Reversing twice does not return to start of values");
+}
+
+template <revrand::direction D>
+static void check_generate_matches_calls(
+    revrand::basic_reversible_mt19937<D> engine)
+{
+    revrand::basic_reversible_mt19937<D> copy = engine;
+    std::vector<std::uint32_t> values(3 * N_VALUES);
+    std::size_t sizes[] = {1, 623, 624, 625, 1248, 3 * N_VALUES - 3121};
+    std::size_t start = 0;
+    /* alternate between output iterator and contiguous array overloads */
+    for (std::size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        if (s % 2 == 0) {
+            engine.generate(values.begin() + start, sizes[s]);
+        }
+        else {
+            engine.generate(values.data() + start, sizes[s]);
+        }
+        start += sizes[s];
+    }
+    for (std::size_t i = 0; i < start; i++) {
+        CHECK(copy() == values[i], "Generated value does not match call");
+    }
+    CHECK(copy == engine, "State after generate does not match calls");
+}
+
+static void test_generate_matches_calls()
+{
+    revrand::reversible_mt19937 engine(SEED);
+    engine.discard(100);
+    check_generate_matches_calls(engine);
+    check_generate_matches_calls(engine.reverse());
+}
+
+static void test_rewind_undoes_calls()
+{
+    revrand::reversible_mt19937 engine(SEED), copy(SEED);
+    engine.discard(700);
+    copy.discard(700);
+    for (int i = 0; i < N_VALUES; i++) {
+        engine();
+    }
+    engine.rewind(N_VALUES);
+    CHECK(engine() == copy(), "Value after rewind does not match");
+}
+
+static void test_std_distributions()
+{
+    revrand::reversible_mt19937 engine(SEED);
+    std::uniform_int_distribution<int> uniform_int(0, 9);
+    std::normal_distribution<double> normal;
+    double mean = 0.;
+    int value;
+    for (int i = 0; i < N_VALUES; i++) {
+        value = uniform_int(engine);
+        CHECK(value >= 0 && value <= 9, "Uniform integer out of range");
+        mean += normal(engine) / N_VALUES;
+    }
+    /* standard error of mean is 1 / sqrt(N_VALUES) ~ 0.014 */
+    CHECK(mean > -0.07 && mean < 0.07, "Normal sample mean too far from 0");
+}
+
+static void test_mismatched_direction_throws()
+{
+    rng_state state;
+    revrand_init_state(SEED, &state);
+    try {
+        revrand::reversed_mt19937 engine(state);
+    }
+    catch (const std::invalid_argument &) {
+        return;
+    }
+    CHECK(false, "Mismatched direction state did not throw");
+}
+
+static void test_philox_state_throws()
+{
+    rng_state state;
+    revrand_init_philox_state(SEED, &state);
+    try {
+        revrand::reversible_mt19937 engine(state);
+    }
+    catch (const std::invalid_argument &) {
+        return;
+    }
+    CHECK(false, "Philox state did not throw");
+}
+
+int main()
+{
+    test_matches_std_mt19937();
+    test_matches_c_interface();
+    test_reverse_regenerates_values();
+    test_generate_matches_calls();
+    test_rewind_undoes_calls();
+    test_std_distributions();
+    test_mismatched_direction_throws();
+    test_philox_state_throws();
+    if (n_failures > 0) {
+        std::fprintf(stderr, "%d test(s) failed\n", n_failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("All tests passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,101 @@
+import io
+import mmap
+import numpy as np
+from revrng.numpy_wrapper import ReversibleRandomState
+from revrng.tapes import HEADER_SIZE, KINDS, Tape, read_tape, write_tape
+
+
+SEED = 12345
+N_VALUES = 10000
+CHUNK_SIZE = 1000
+
+
+def test_tape_values_match_generated_values():
+    for kind in KINDS:
+        name, dtype, _, method, kwargs, _ = kind
+        state = ReversibleRandomState(SEED)
+        state.random_int32(17)
+        expected_state = ReversibleRandomState(SEED)
+        expected_state.random_int32(17)
+        expected = getattr(expected_state, method)(N_VALUES, **kwargs)
+        output = io.BytesIO()
+        write_tape(state, output, N_VALUES, name, CHUNK_SIZE)
+        data = output.getvalue()
+        assert len(data) == HEADER_SIZE + N_VALUES * np.dtype(dtype).itemsize
+        values = np.frombuffer(data, dtype, offset=HEADER_SIZE)
+        assert np.all(values == expected), (
+            'Values written to {0} tape do not match generated values'
+            .format(name)
+        )
+        assert np.all(state.get_state()['key'] ==
+                      expected_state.get_state()['key']), (
+            'State after writing {0} tape does not match'.format(name)
+        )
+
+
+def test_chunks_regenerated_from_header():
+    state = ReversibleRandomState(SEED)
+    output = io.BytesIO()
+    write_tape(state, output, N_VALUES + 1, 'uniform', CHUNK_SIZE)
+    data = output.getvalue()
+    values = np.frombuffer(data, np.float64, offset=HEADER_SIZE)
+    tape = read_tape(io.BytesIO(data[:HEADER_SIZE]))
+    assert tape.n_chunks == N_VALUES // CHUNK_SIZE + 1
+    for k in [tape.n_chunks - 1, 3, 0]:
+        start = k * CHUNK_SIZE
+        assert np.all(tape.chunk(k) ==
+                      values[start:start + tape.chunk_length(k)]), (
+            'Regenerated chunk {0} does not match written values'.format(k)
+        )
+    assert np.all(np.concatenate(list(tape.chunks())) == values), (
+        'Regenerated chunks do not match written values'
+    )
+    assert np.all(
+        np.concatenate(list(tape.chunks(reverse=True))[::-1]) == values), (
+        'Reverse regenerated chunks do not match written chunks'
+    )
+
+
+def test_header_only_tape_round_trips():
+    state = ReversibleRandomState(SEED)
+    state.reverse()
+    state.random_int32(100)
+    output = io.BytesIO()
+    tape = write_tape(
+        state, output, N_VALUES, 'normal', CHUNK_SIZE, values=False)
+    assert len(output.getvalue()) == HEADER_SIZE
+    tape_read = Tape.from_bytes(output.getvalue())
+    for attr in ['n_values', 'kind', 'chunk_size', 'n_chunks']:
+        assert getattr(tape_read, attr) == getattr(tape, attr), (
+            'Tape {0} does not match after reading header'.format(attr)
+        )
+    assert np.all(tape_read.chunk(2) == tape.chunk(2)), (
+        'Chunks of tape read from header do not match'
+    )
+
+
+def test_philox_tape_regenerated_from_header():
+    state = ReversibleRandomState(SEED, engine='philox')
+    output = io.BytesIO()
+    write_tape(state, output, N_VALUES, 'int64', CHUNK_SIZE)
+    data = output.getvalue()
+    tape = Tape.from_bytes(data[:HEADER_SIZE])
+    assert tape.state['engine'] == 'philox'
+    assert np.all(np.concatenate(list(tape.chunks())) ==
+                  np.frombuffer(data, np.uint64, offset=HEADER_SIZE)), (
+        'Regenerated Philox tape does not match written values'
+    )
+
+
+def test_write_to_memory_map():
+    size = HEADER_SIZE + N_VALUES * np.dtype(np.uint32).itemsize
+    buffer = mmap.mmap(-1, size)
+    state = ReversibleRandomState(SEED)
+    tape = write_tape(state, buffer, N_VALUES, 'int32', CHUNK_SIZE)
+    values = np.frombuffer(buffer, np.uint32, offset=HEADER_SIZE)
+    assert np.all(values == np.concatenate(list(tape.chunks()))), (
+        'Values written to memory map do not match regenerated values'
+    )
+    assert read_tape(buffer).n_values == N_VALUES
+    del values
+    buffer.close()
@@ -12,13 +12,44 @@ import numpy
 import os
 from Cython.Build import cythonize
 
+# Disable contraction of multiply-adds so generated normal values do not depend
+# on the platform, and floating point errno / trapping semantics so that the
+# transcendental function kernels in revrand.c can be vectorized.
+if os.name == 'nt':
+    extra_compile_args = []
+else:
+    extra_compile_args = [
+        '-ffp-contract=off', '-fno-math-errno', '-fno-trapping-math']
+
+# Counts of generator work (ReversibleRandomState.counters) are compiled out
+# unless the REVRNG_COUNTERS environment variable is set, e.g.
+#   REVRNG_COUNTERS=1 python setup.py build_ext --inplace
+if os.environ.get('REVRNG_COUNTERS', '0') not in ('', '0'):
+    define_macros = [('REVRAND_COUNTERS', '1')]
+else:
+    define_macros = []
+
 ext_modules = [
     Extension('revrng.numpy_wrapper',
               [os.path.join('revrng', file_name) for file_name
                in ['numpy_wrapper.pyx', 'revrand.c']],
-              include_dirs=[numpy.get_include()])
+              include_dirs=[numpy.get_include()],
+              define_macros=define_macros,
+              extra_compile_args=extra_compile_args)
 ]
 
+# The numpy.random BitGenerator interface requires numpy 1.17 or later, with
+# the Cython declarations needed to subclass it installed from numpy 1.19.
+if os.path.exists(os.path.join(
+        os.path.dirname(numpy.__file__), 'random', 'bit_generator.pxd')):
+    ext_modules.append(
+        Extension('revrng.bit_generator',
+                  [os.path.join('revrng', file_name) for file_name
+                   in ['bit_generator.pyx', 'revrand.c']],
+                  include_dirs=[numpy.get_include(), 'revrng'],
+                  define_macros=define_macros,
+                  extra_compile_args=extra_compile_args))
+
 ext_modules = cythonize(ext_modules)
 
 setup(
@@ -26,5 +57,6 @@ setup(
     description='Reversible Mersenne-Twister random number generator',
     author='Matt Graham',
     ext_modules=ext_modules,
-    packages=['revrng']
+    packages=['revrng'],
+    package_data={'revrng': ['numpy_wrapper.pxd', 'revrand.h']}
 )